@@ -23,6 +23,7 @@
 #include "Interface.h"
 #include "Location.h"
 #include "Scope.h"
+#include "TimeReport.h"
 #include "TypeDef.h"
 
 #include <android-base/logging.h>
@@ -45,6 +46,10 @@ Scope* AST::getRootScope() {
     return &mRootScope;
 }
 
+Arena& AST::getArena() {
+    return mArena;
+}
+
 // used by the parser.
 void AST::addSyntaxError() {
     mSyntaxErrors++;
@@ -88,59 +93,69 @@ bool AST::containsInterfaces() const {
 }
 
 status_t AST::postParse() {
+    // Each pass, or batch of fused passes, is timed separately, see TimeReport.
+    const std::string name =
+        TimeReport::isEnabled()
+            ? FQName(mPackage.package(), mPackage.version(), getBaseName()).string()
+            : "";
+    const auto runPass = [&](const char* pass, const std::function<status_t()>& func) {
+        TimeReport::Phase phase(pass, name);
+        return func();
+    };
+
     status_t err;
 
     // lookupTypes is the first pass.
-    err = lookupTypes();
+    err = runPass("lookupTypes", [&] { return lookupTypes(); });
     if (err != OK) return err;
     // validateDefinedTypesUniqueNames is the first call
     // after lookup, as other errors could appear because
     // user meant different type than we assumed.
-    err = validateDefinedTypesUniqueNames();
+    err = runPass("validateDefinedTypesUniqueNames",
+                  [&] { return validateDefinedTypesUniqueNames(); });
     if (err != OK) return err;
     // topologicalReorder is before resolveInheritance, as we
     // need to have no cycle while getting parent class.
-    err = topologicalReorder();
-    if (err != OK) return err;
-    err = resolveInheritance();
-    if (err != OK) return err;
-    err = lookupLocalIdentifiers();
-    if (err != OK) return err;
-    // checkAcyclicConstantExpressions is after resolveInheritance,
-    // as resolveInheritance autofills enum values.
-    err = checkAcyclicConstantExpressions();
-    if (err != OK) return err;
-    err = evaluate();
+    err = runPass("topologicalReorder", [&] { return topologicalReorder(); });
     if (err != OK) return err;
-    err = validate();
+    err = runPass("resolveInheritance", [&] { return resolveInheritance(); });
     if (err != OK) return err;
-    err = checkForwardReferenceRestrictions();
-    if (err != OK) return err;
-    err = gatherReferencedTypes();
+    err = runPass("lookupLocalIdentifiers", [&] { return lookupLocalIdentifiers(); });
     if (err != OK) return err;
 
-    // Make future packages not to call passes
-    // for processed types and expressions
-    constantExpressionRecursivePass(
-        [](ConstantExpression* ce) {
-            ce->setPostParseCompleted();
-            return OK;
-        },
-        true /* processBeforeDependencies */);
-    std::unordered_set<const Type*> visited;
-    mRootScope.recursivePass(
-        [](Type* type) {
-            type->setPostParseCompleted();
+    // The remaining passes only need the earlier ones to have run on a type
+    // and on what it refers to, so they share a single walk. Their order
+    // within it is the order they used to run in as separate passes:
+    // checkAcyclicConstantExpressions is after resolveInheritance, as
+    // resolveInheritance autofills enum values. setPostParseCompleted makes
+    // future packages not to call passes for processed types and expressions.
+    PostParseWalk walk;
+    return runPass("evaluateAndValidate", [&] {
+        return runFusedPasses({
+            [&](Type* type) { return checkAcyclicConstantExpressions(type, &walk); },
+            [&](Type* type) { return evaluate(type, &walk); },
+            [&](Type* type) { return validate(type); },
+            [&](Type* type) { return checkForwardReferenceRestrictions(type); },
+            [&](Type* type) { return gatherReferencedTypes(type); },
+            [&](Type* type) { return setPostParseCompleted(type, &walk); },
+        });
+    });
+}
+
+status_t AST::runFusedPasses(const std::vector<TypePass>& passes) {
+    return mRootScope.recursivePass(
+        [&](Type* type) -> status_t {
+            for (const TypePass& pass : passes) {
+                status_t err = pass(type);
+                if (err != OK) return err;
+            }
             return OK;
         },
-        &visited);
-
-    return OK;
+        Type::newVisitEpoch());
 }
 
 status_t AST::constantExpressionRecursivePass(
     const std::function<status_t(ConstantExpression*)>& func, bool processBeforeDependencies) {
-    std::unordered_set<const Type*> visitedTypes;
     std::unordered_set<const ConstantExpression*> visitedCE;
     return mRootScope.recursivePass(
         [&](Type* type) -> status_t {
@@ -150,11 +165,10 @@ status_t AST::constantExpressionRecursivePass(
             }
             return OK;
         },
-        &visitedTypes);
+        Type::newVisitEpoch());
 }
 
 status_t AST::lookupTypes() {
-    std::unordered_set<const Type*> visited;
     return mRootScope.recursivePass(
         [&](Type* type) -> status_t {
             Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
@@ -176,28 +190,22 @@ status_t AST::lookupTypes() {
 
             return OK;
         },
-        &visited);
+        Type::newVisitEpoch());
 }
 
-status_t AST::gatherReferencedTypes() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [&](Type* type) -> status_t {
-            for (auto* nextRef : type->getReferences()) {
-                const Type *targetType = nextRef->get();
-                if (targetType->isNamedType()) {
-                    mReferencedTypeNames.insert(
-                            static_cast<const NamedType *>(targetType)->fqName());
-                }
-            }
+status_t AST::gatherReferencedTypes(const Type* type) {
+    for (auto* nextRef : type->getReferences()) {
+        const Type *targetType = nextRef->get();
+        if (targetType->isNamedType()) {
+            mReferencedTypeNames.insert(
+                    static_cast<const NamedType *>(targetType)->fqName());
+        }
+    }
 
-            return OK;
-        },
-        &visited);
+    return OK;
 }
 
 status_t AST::lookupLocalIdentifiers() {
-    std::unordered_set<const Type*> visitedTypes;
     std::unordered_set<const ConstantExpression*> visitedCE;
 
     return mRootScope.recursivePass(
@@ -222,11 +230,10 @@ status_t AST::lookupLocalIdentifiers() {
 
             return OK;
         },
-        &visitedTypes);
+        Type::newVisitEpoch());
 }
 
 status_t AST::validateDefinedTypesUniqueNames() const {
-    std::unordered_set<const Type*> visited;
     return mRootScope.recursivePass(
         [&](const Type* type) -> status_t {
             // We only want to validate type definition names in this place.
@@ -235,26 +242,29 @@ status_t AST::validateDefinedTypesUniqueNames() const {
             }
             return OK;
         },
-        &visited);
+        Type::newVisitEpoch());
 }
 
 status_t AST::resolveInheritance() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(&Type::resolveInheritance, &visited);
-}
-
-status_t AST::evaluate() {
-    return constantExpressionRecursivePass(
-        [](ConstantExpression* ce) {
-            ce->evaluate();
-            return OK;
-        },
-        false /* processBeforeDependencies */);
+    return mRootScope.recursivePass(&Type::resolveInheritance, Type::newVisitEpoch());
+}
+
+status_t AST::evaluate(Type* type, PostParseWalk* walk) {
+    for (auto* ce : type->getConstantExpressions()) {
+        // Dependencies first, they may belong to types not walked yet.
+        status_t err = ce->recursivePass(
+            [](ConstantExpression* ce) {
+                ce->evaluate();
+                return OK;
+            },
+            &walk->evaluatedCE, false /* processBeforeDependencies */);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
-status_t AST::validate() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(&Type::validate, &visited);
+status_t AST::validate(const Type* type) const {
+    return type->validate();
 }
 
 status_t AST::topologicalReorder() {
@@ -263,7 +273,6 @@ status_t AST::topologicalReorder() {
     status_t err = mRootScope.topologicalOrder(&reversedOrder, &stack).status;
     if (err != OK) return err;
 
-    std::unordered_set<const Type*> visited;
     mRootScope.recursivePass(
         [&](Type* type) {
             if (type->isScope()) {
@@ -271,40 +280,46 @@ status_t AST::topologicalReorder() {
             }
             return OK;
         },
-        &visited);
+        Type::newVisitEpoch());
     return OK;
 }
 
-status_t AST::checkAcyclicConstantExpressions() const {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-    std::unordered_set<const ConstantExpression*> stack;
-    return mRootScope.recursivePass(
-        [&](const Type* type) -> status_t {
-            for (auto* ce : type->getConstantExpressions()) {
-                status_t err = ce->checkAcyclic(&visitedCE, &stack).status;
-                CHECK(err != OK || stack.empty());
-                if (err != OK) return err;
-            }
-            return OK;
-        },
-        &visitedTypes);
+status_t AST::checkAcyclicConstantExpressions(const Type* type, PostParseWalk* walk) const {
+    for (auto* ce : type->getConstantExpressions()) {
+        status_t err = ce->checkAcyclic(&walk->acyclicCE, &walk->stack).status;
+        CHECK(err != OK || walk->stack.empty());
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
-status_t AST::checkForwardReferenceRestrictions() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        [](const Type* type) -> status_t {
-            for (const Reference<Type>* ref : type->getReferences()) {
-                status_t err = type->checkForwardReferenceRestrictions(*ref);
-                if (err != OK) return err;
-            }
-            return OK;
-        },
-        &visited);
+status_t AST::checkForwardReferenceRestrictions(const Type* type) const {
+    for (const Reference<Type>* ref : type->getReferences()) {
+        status_t err = type->checkForwardReferenceRestrictions(*ref);
+        if (err != OK) return err;
+    }
+    return OK;
+}
+
+status_t AST::setPostParseCompleted(Type* type, PostParseWalk* walk) {
+    // The walk never comes back to this type, nor to the expressions it
+    // depends on, which have been checked and evaluated along with it.
+    for (auto* ce : type->getConstantExpressions()) {
+        status_t err = ce->recursivePass(
+            [](ConstantExpression* ce) {
+                ce->setPostParseCompleted();
+                return OK;
+            },
+            &walk->completedCE, true /* processBeforeDependencies */);
+        if (err != OK) return err;
+    }
+    type->setPostParseCompleted();
+    return OK;
 }
 
 bool AST::addImport(const char *import) {
+    mImports.push_back(import);
+
     FQName fqName;
     if (!FQName::parse(import, &fqName)) {
         std::cerr << "ERROR: '" << import << "' is an invalid fully-qualified name." << std::endl;
@@ -325,6 +340,7 @@ bool AST::addImport(const char *import) {
         if (err != OK) {
             return false;
         }
+        mCoordinator->prefetch(packageInterfaces);
 
         for (const auto &subFQName : packageInterfaces) {
             addToImportedNamesGranular(subFQName);
@@ -25,8 +25,10 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "Arena.h"
 #include "Scope.h"
 #include "Type.h"
 
@@ -99,26 +101,10 @@ struct AST {
     // that depend on super types
     status_t resolveInheritance();
 
-    // Recursive tree pass that evaluates constant expressions
-    status_t evaluate();
-
-    // Recursive tree pass that validates all type-related
-    // syntax restrictions
-    status_t validate() const;
-
     // Recursive tree pass that ensures that type definitions and references
     // are acyclic and reorderes type definitions in reversed topological order.
     status_t topologicalReorder();
 
-    // Recursive tree pass that ensures that constant expressions
-    // are acyclic.
-    status_t checkAcyclicConstantExpressions() const;
-
-    // Recursive tree pass that checks C++ forward declaration restrictions.
-    status_t checkForwardReferenceRestrictions() const;
-
-    status_t gatherReferencedTypes();
-
     void generateCppSource(Formatter& out) const;
 
     void generateInterfaceHeader(Formatter& out) const;
@@ -138,6 +124,11 @@ struct AST {
 
     void generateVts(Formatter& out) const;
 
+    void generateCppBenchSource(Formatter& out) const;
+
+    void generateMarshalCostJson(Formatter& out) const;
+    void generateMarshalCostTable(Formatter& out) const;
+
     void getImportedPackages(std::set<FQName> *importSet) const;
 
     // Run getImportedPackages on this, then run getImportedPackages on
@@ -180,6 +171,9 @@ struct AST {
 
     Scope* getRootScope();
 
+    // Owns every node the parser creates for this AST.
+    Arena& getArena();
+
     static void generateCppPackageInclude(Formatter& out, const FQName& package,
                                           const std::string& klass);
 
@@ -189,6 +183,9 @@ struct AST {
     void addToImportedNamesGranular(const FQName &fqName);
 
    private:
+    // Declared first, so that its nodes outlive everything referring to them.
+    Arena mArena;
+
     const Coordinator* mCoordinator;
     const Hash* mFileHash;
 
@@ -223,7 +220,15 @@ struct AST {
     // used by the parser.
     size_t mSyntaxErrors = 0;
 
-    std::set<FQName> mReferencedTypeNames;
+    std::unordered_set<FQName> mReferencedTypeNames;
+
+    // Arguments of every addImport call, in order, so that an AST loaded
+    // from the cache imports the same ASTs again.
+    std::vector<std::string> mImports;
+
+    // Identifies the contents of this AST and of everything it was resolved
+    // against, see ASTCache. Empty unless the AST cache is enabled.
+    std::string mCacheDigest;
 
     // Helper functions for lookupType.
     Type* lookupTypeLocally(const FQName& fqName, Scope* scope);
@@ -235,6 +240,35 @@ struct AST {
     // Only types defined in this very AST are considered.
     Type *findDefinedType(const FQName &fqName, FQName *matchingName) const;
 
+    // Runs every pass on a type before moving on to the next one, so that
+    // all of them share a single walk over the tree.
+    using TypePass = std::function<status_t(Type*)>;
+    status_t runFusedPasses(const std::vector<TypePass>& passes);
+
+    // State the passes fused by postParse share across the walk.
+    struct PostParseWalk {
+        std::unordered_set<const ConstantExpression*> acyclicCE;
+        std::unordered_set<const ConstantExpression*> stack;
+        std::unordered_set<const ConstantExpression*> evaluatedCE;
+        std::unordered_set<const ConstantExpression*> completedCE;
+    };
+
+    // Ensures that constant expressions are acyclic.
+    status_t checkAcyclicConstantExpressions(const Type* type, PostParseWalk* walk) const;
+
+    // Evaluates constant expressions.
+    status_t evaluate(Type* type, PostParseWalk* walk);
+
+    // Validates all type-related syntax restrictions.
+    status_t validate(const Type* type) const;
+
+    // Checks C++ forward declaration restrictions.
+    status_t checkForwardReferenceRestrictions(const Type* type) const;
+
+    status_t gatherReferencedTypes(const Type* type);
+
+    status_t setPostParseCompleted(Type* type, PostParseWalk* walk);
+
     void getPackageComponents(std::vector<std::string> *components) const;
 
     void getPackageAndVersionComponents(
@@ -266,6 +300,8 @@ struct AST {
     void generateProxyMethodSource(Formatter& out, const std::string& className,
                                    const Method* method, const Interface* superInterface) const;
     void generateAdapterMethod(Formatter& out, const Method* method) const;
+    void generateCppBenchMarshalling(Formatter& out, const Method* method,
+                                     bool forResults) const;
 
     void generateFetchSymbol(Formatter &out, const std::string &ifaceName) const;
 
@@ -273,6 +309,10 @@ struct AST {
 
     void generateStubSource(Formatter& out, const Interface* iface) const;
 
+    // onTransact dispatch for IBase, which has inline reserved methods.
+    void generateStubSwitch(Formatter& out, const Interface* iface) const;
+    // onTransact dispatch for any other interface, indexed by serial id.
+    void generateStubTransactionTable(Formatter& out, const Interface* iface) const;
     void generateStubSourceForMethod(Formatter& out, const Method* method,
                                      const Interface* superInterface) const;
     void generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
@@ -324,6 +364,8 @@ struct AST {
     void emitJavaTypeDeclarations(Formatter& out) const;
     void emitVtsTypeDeclarations(Formatter& out) const;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(AST);
 };
 
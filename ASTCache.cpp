@@ -0,0 +1,1152 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ASTCache.h"
+
+#include "AST.h"
+#include "Annotation.h"
+#include "ArrayType.h"
+#include "CompoundType.h"
+#include "ConstantExpression.h"
+#include "Coordinator.h"
+#include "DeathRecipientType.h"
+#include "DocComment.h"
+#include "EnumType.h"
+#include "FmqType.h"
+#include "HandleType.h"
+#include "Interface.h"
+#include "Location.h"
+#include "MemoryType.h"
+#include "Method.h"
+#include "PointerType.h"
+#include "RefType.h"
+#include "ScalarType.h"
+#include "Scope.h"
+#include "StringType.h"
+#include "TypeDef.h"
+#include "VectorType.h"
+
+#include <android-base/logging.h>
+#include <hidl-hash/Hash.h>
+#include <hidl-util/FQName.h>
+#include <openssl/sha.h>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace android {
+
+// Must change whenever the format below, or what it restores, changes.
+static const char* const kASTCacheHeader = "hidl-gen ast cache 1";
+
+namespace {
+
+// Entries are a sequence of integers, written as "<decimal> ", and strings,
+// written as "<length>:<bytes>", so that strings may contain anything.
+// Newlines only end records, to keep entries readable when debugging.
+struct Writer {
+    void writeInt(uint64_t value) {
+        mData += std::to_string(value);
+        mData += ' ';
+    }
+
+    void writeBool(bool value) { writeInt(value ? 1 : 0); }
+
+    void writeString(const std::string& value) {
+        mData += std::to_string(value.size());
+        mData += ':';
+        mData += value;
+    }
+
+    void endRecord() { mData += '\n'; }
+
+    void append(const Writer& other) { mData += other.mData; }
+
+    const std::string& data() const { return mData; }
+
+   private:
+    std::string mData;
+};
+
+// Reads what Writer wrote. Once anything is malformed, ok() is false and all
+// reads return empty values.
+struct Reader {
+    explicit Reader(const std::string& data) : mData(data) {}
+
+    bool ok() const { return mOk; }
+
+    bool atEnd() {
+        skipNewlines();
+        return mOk && mPos == mData.size();
+    }
+
+    uint64_t readInt() {
+        uint64_t value;
+        if (!readDecimal(&value) || !consume(' ')) {
+            return fail<uint64_t>();
+        }
+        return value;
+    }
+
+    bool readBool() { return readInt() != 0; }
+
+    std::string readString() {
+        uint64_t length;
+        if (!readDecimal(&length) || !consume(':') || length > mData.size() - mPos) {
+            return fail<std::string>();
+        }
+        std::string value = mData.substr(mPos, length);
+        mPos += length;
+        return value;
+    }
+
+    // Reads the number of items that follow. Each of them takes at least one
+    // byte, so a corrupt count cannot make the caller allocate more than that.
+    size_t readCount() {
+        uint64_t count = readInt();
+        if (count > mData.size() - mPos) {
+            return fail<size_t>();
+        }
+        return count;
+    }
+
+   private:
+    const std::string& mData;
+    size_t mPos = 0;
+    bool mOk = true;
+
+    template <typename T>
+    T fail() {
+        mOk = false;
+        mPos = mData.size();
+        return T();
+    }
+
+    void skipNewlines() {
+        while (mPos < mData.size() && mData[mPos] == '\n') {
+            mPos++;
+        }
+    }
+
+    bool consume(char c) {
+        if (mPos == mData.size() || mData[mPos] != c) {
+            return false;
+        }
+        mPos++;
+        return true;
+    }
+
+    bool readDecimal(uint64_t* value) {
+        skipNewlines();
+        size_t start = mPos;
+        *value = 0;
+        while (mPos < mData.size() && mData[mPos] >= '0' && mData[mPos] <= '9') {
+            uint64_t digit = mData[mPos] - '0';
+            if (*value > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+                return false;
+            }
+            *value = *value * 10 + digit;
+            mPos++;
+        }
+        return mPos != start;
+    }
+};
+
+enum TypeKind : uint64_t {
+    // Types with a name, defined by the AST.
+    KIND_TYPE_DEF,
+    KIND_INTERFACE,
+    KIND_ENUM,
+    KIND_COMPOUND,
+
+    // Anonymous types, built by the AST from what its declarations use.
+    KIND_SCALAR,
+    KIND_STRING,
+    KIND_HANDLE,
+    KIND_MEMORY,
+    KIND_POINTER,
+    KIND_DEATH_RECIPIENT,
+    KIND_VECTOR,
+    KIND_REF,
+    KIND_BIT_FIELD,
+    KIND_FMQ,
+    KIND_ARRAY,
+};
+
+enum ReferenceKind : uint64_t {
+    REFERENCE_EMPTY,
+    // Refers to a type of the cached AST, by id.
+    REFERENCE_LOCAL,
+    // Refers to a named type of one of the ASTs it depends on, by full name.
+    REFERENCE_IMPORTED,
+};
+
+// The file of the AST, which is what Coordinator::parse takes to return it.
+FQName getFileName(const AST* ast) {
+    const Interface* iface = ast->getInterface();
+    return FQName(ast->package().package(), ast->package().version(),
+                  iface != nullptr ? iface->localName() : "types");
+}
+
+// The hash of the contents of the file of the AST. Its Hash is cleared
+// for interfaces which are not frozen, see Coordinator::checkHash.
+std::string getContentHash(const AST* ast) {
+    const Hash* fileHash = ast->getFileHash();
+    if (fileHash->raw() != Hash::kEmptyHash) {
+        return fileHash->hexString();
+    }
+    return Hash::hexString(Hash::computeHash(ast->getFilename()));
+}
+
+}  // namespace
+
+std::string ASTCache::computeDigest(const AST* ast, std::vector<const AST*> imports) {
+    std::sort(imports.begin(), imports.end(), [](const AST* lhs, const AST* rhs) {
+        return getFileName(lhs) < getFileName(rhs);
+    });
+
+    std::string contents = getContentHash(ast);
+    for (const AST* import : imports) {
+        contents += " " + getFileName(import).string() + " " + import->mCacheDigest;
+    }
+
+    std::vector<uint8_t> digest(SHA256_DIGEST_LENGTH);
+    SHA256(reinterpret_cast<const uint8_t*>(contents.data()), contents.size(), digest.data());
+    return Hash::hexString(digest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ASTCache::Serializer {
+    explicit Serializer(AST* ast) : mAST(ast) {}
+
+    bool serialize(const std::string& key, std::string* data) {
+        std::vector<const AST*> imports(mAST->mImportedASTs.begin(), mAST->mImportedASTs.end());
+        std::sort(imports.begin(), imports.end(), [](const AST* lhs, const AST* rhs) {
+            return getFileName(lhs) < getFileName(rhs);
+        });
+        for (const AST* import : imports) {
+            if (import->mCacheDigest.empty()) {
+                return false;
+            }
+            addDependency(import);
+        }
+
+        mTypeIds[&mAST->mRootScope] = 0;
+        addNamedTypes(&mAST->mRootScope);
+
+        Writer namedTypes;
+        for (const NamedType* type : mNamedTypes) {
+            writeNamedType(&namedTypes, type);
+        }
+
+        // Also assigns ids to the anonymous types, and adds dependencies.
+        Writer bodies;
+        for (const NamedType* type : mNamedTypes) {
+            writeBody(&bodies, type);
+        }
+        bodies.writeBool(mAST->mRootScope.mTypeOrderChanged);
+        bodies.endRecord();
+        writeNames(&bodies, mAST->mImportedNames);
+        writeNames(&bodies, mAST->mReferencedTypeNames);
+
+        if (!mOk) {
+            return false;
+        }
+
+        mAST->mCacheDigest = computeDigest(mAST, imports);
+
+        Writer out;
+        out.writeString(kASTCacheHeader);
+        out.writeString(key);
+        out.writeString(getContentHash(mAST));
+        out.endRecord();
+
+        out.writeString(mAST->mPackage.string());
+        out.endRecord();
+        out.writeInt(mAST->mImports.size());
+        for (const std::string& import : mAST->mImports) {
+            out.writeString(import);
+        }
+        out.endRecord();
+
+        out.writeInt(mDependencies.size());
+        out.writeInt(imports.size());
+        out.endRecord();
+        for (const AST* dependency : mDependencies) {
+            out.writeString(getFileName(dependency).string());
+            out.writeString(dependency->mCacheDigest);
+            out.endRecord();
+        }
+
+        out.writeInt(mNamedTypes.size());
+        out.endRecord();
+        out.append(namedTypes);
+        out.writeInt(mAnonymousTypeCount);
+        out.endRecord();
+        out.append(mAnonymousTypes);
+        out.append(bodies);
+
+        *data = out.data();
+        return true;
+    }
+
+   private:
+    AST* const mAST;
+    bool mOk = true;
+
+    // 0 is the root scope, then come the named types in mNamedTypes order,
+    // then the anonymous types in the order they are written.
+    std::unordered_map<const Type*, size_t> mTypeIds;
+    std::vector<const NamedType*> mNamedTypes;
+    size_t mAnonymousTypeCount = 0;
+    Writer mAnonymousTypes;
+
+    // The imports of mAST, then the other ASTs defining types it refers to.
+    std::vector<const AST*> mDependencies;
+    std::unordered_map<const AST*, size_t> mDependencyIds;
+
+    // Which AST, out of everything mAST imports directly or indirectly,
+    // defines each named type. Only filled once it is needed.
+    std::unordered_map<const Type*, const AST*> mDefiningASTs;
+
+    size_t addDependency(const AST* ast) {
+        auto it = mDependencyIds.find(ast);
+        if (it != mDependencyIds.end()) {
+            return it->second;
+        }
+        mDependencies.push_back(ast);
+        mDependencyIds[ast] = mDependencies.size() - 1;
+        return mDependencies.size() - 1;
+    }
+
+    const AST* findDefiningAST(const Type* type) {
+        if (mDefiningASTs.empty()) {
+            std::vector<const AST*> pending(mAST->mImportedASTs.begin(),
+                                            mAST->mImportedASTs.end());
+            std::set<const AST*> visited(pending.begin(), pending.end());
+            while (!pending.empty()) {
+                const AST* ast = pending.back();
+                pending.pop_back();
+
+                for (const auto& pair : ast->mDefinedTypesByFullName) {
+                    mDefiningASTs[pair.second] = ast;
+                }
+                for (const AST* import : ast->mImportedASTs) {
+                    if (visited.insert(import).second) {
+                        pending.push_back(import);
+                    }
+                }
+            }
+        }
+
+        auto it = mDefiningASTs.find(type);
+        return it == mDefiningASTs.end() ? nullptr : it->second;
+    }
+
+    void addNamedTypes(const Scope* scope) {
+        for (const NamedType* type : scope->mTypes) {
+            mTypeIds[type] = mNamedTypes.size() + 1;
+            mNamedTypes.push_back(type);
+            if (type->isScope()) {
+                addNamedTypes(static_cast<const Scope*>(type));
+            }
+        }
+    }
+
+    // The id of the scope of type, if it is one of ours, and 0 otherwise.
+    size_t getParentId(const Type* type) const {
+        auto it = mTypeIds.find(type->parent());
+        return it == mTypeIds.end() ? 0 : it->second;
+    }
+
+    void writeNamedType(Writer* out, const NamedType* type) {
+        // TypeDef must come first, as it forwards the other predicates.
+        TypeKind kind;
+        if (type->isTypeDef()) {
+            kind = KIND_TYPE_DEF;
+        } else if (type->isInterface()) {
+            kind = KIND_INTERFACE;
+        } else if (type->isEnum()) {
+            kind = KIND_ENUM;
+        } else if (type->isCompoundType()) {
+            kind = KIND_COMPOUND;
+        } else {
+            mOk = false;
+            return;
+        }
+
+        out->writeInt(kind);
+        out->writeInt(getParentId(type));
+        out->writeString(type->localName());
+        writeLocation(out, type->location());
+        writeDocComment(out, type);
+        if (kind == KIND_COMPOUND) {
+            out->writeInt(static_cast<const CompoundType*>(type)->style());
+        }
+        out->endRecord();
+    }
+
+    void writeBody(Writer* out, const NamedType* type) {
+        if (type->isTypeDef()) {
+            writeReference(out, static_cast<const TypeDef*>(type)->mReferencedType);
+            out->endRecord();
+            return;
+        }
+
+        const Scope* scope = static_cast<const Scope*>(type);
+        writeAnnotations(out, scope->mAnnotations);
+        out->writeBool(scope->mTypeOrderChanged);
+
+        if (type->isInterface()) {
+            const Interface* iface = static_cast<const Interface*>(type);
+            writeReference(out, iface->mSuperType);
+
+            // The reserved methods are created again from IBase on load.
+            std::vector<const Method*> methods;
+            if (iface->isIBase()) {
+                for (const auto& pair : iface->mDeclaredReservedMethods) {
+                    methods.push_back(pair.second);
+                }
+            } else {
+                methods.insert(methods.end(), iface->mUserMethods.begin(),
+                               iface->mUserMethods.end());
+            }
+            out->writeInt(methods.size());
+            for (const Method* method : methods) {
+                writeMethod(out, method);
+            }
+        } else if (type->isEnum()) {
+            const EnumType* enumType = static_cast<const EnumType*>(type);
+            writeReference(out, enumType->mStorageType);
+            out->writeInt(enumType->mValues.size());
+            for (const EnumValue* value : enumType->mValues) {
+                out->writeString(value->name());
+                writeLocation(out, value->location());
+                writeDocComment(out, value);
+                writeConstantExpression(out, value->mValue);
+                out->writeBool(value->mIsAutoFill);
+            }
+        } else {
+            const CompoundType* compoundType = static_cast<const CompoundType*>(type);
+            if (compoundType->mFields == nullptr) {
+                mOk = false;
+                return;
+            }
+            writeNamedReferences(out, *compoundType->mFields);
+        }
+        out->endRecord();
+    }
+
+    void writeMethod(Writer* out, const Method* method) {
+        out->writeString(method->name());
+        out->writeBool(method->isOneway());
+        writeLocation(out, method->location());
+        writeDocComment(out, method);
+        writeAnnotations(out, method->annotations());
+        writeNamedReferences(out, method->args());
+        writeNamedReferences(out, method->results());
+        out->writeInt(method->getSerialId());
+    }
+
+    void writeNamedReferences(Writer* out, const std::vector<NamedReference<Type>*>& references) {
+        out->writeInt(references.size());
+        for (const NamedReference<Type>* reference : references) {
+            out->writeString(reference->name());
+            writeReference(out, *reference);
+            writeDocComment(out, reference);
+        }
+    }
+
+    void writeReference(Writer* out, const Reference<Type>& reference) {
+        if (!reference.isResolved()) {
+            if (!reference.isEmptyReference()) {
+                mOk = false;
+            }
+            out->writeInt(REFERENCE_EMPTY);
+            return;
+        }
+
+        const Type* type = reference.shallowGet();
+        auto it = mTypeIds.find(type);
+        if (it != mTypeIds.end()) {
+            out->writeInt(REFERENCE_LOCAL);
+            out->writeInt(it->second);
+        } else if (type->isNamedType()) {
+            const AST* ast = findDefiningAST(type);
+            if (ast == nullptr) {
+                mOk = false;
+                return;
+            }
+            out->writeInt(REFERENCE_IMPORTED);
+            out->writeInt(addDependency(ast));
+            out->writeString(static_cast<const NamedType*>(type)->fqName().string());
+        } else {
+            // Anonymous types are copied, even when they were built by
+            // another AST (e.g. the element type of a flattened array).
+            size_t id = addAnonymousType(type);
+            out->writeInt(REFERENCE_LOCAL);
+            out->writeInt(id);
+        }
+        writeLocation(out, reference.hasLocation() ? reference.location() : Location());
+    }
+
+    size_t addAnonymousType(const Type* type) {
+        // Written separately, as this writes the types it refers to first.
+        Writer record;
+        const TypeKind kind = getAnonymousKind(type);
+        record.writeInt(kind);
+        record.writeInt(getParentId(type));
+        if (type->isScalar()) {
+            record.writeInt(static_cast<const ScalarType*>(type)->getKind());
+        } else if (type->isArray()) {
+            const ArrayType* arrayType = static_cast<const ArrayType*>(type);
+            writeReference(&record, arrayType->mElementType);
+            record.writeInt(arrayType->mSizes.size());
+            for (const ConstantExpression* size : arrayType->mSizes) {
+                writeConstantExpression(&record, size);
+            }
+        } else if (type->isTemplatedType()) {
+            if (kind == KIND_FMQ) {
+                const FmqType* fmqType = static_cast<const FmqType*>(type);
+                record.writeString(fmqType->mNamespace);
+                record.writeString(fmqType->mName);
+            }
+            writeReference(&record, static_cast<const TemplatedType*>(type)->mElementType);
+        }
+        record.endRecord();
+
+        size_t id = 1 + mNamedTypes.size() + mAnonymousTypeCount++;
+        mTypeIds[type] = id;
+        mAnonymousTypes.append(record);
+        return id;
+    }
+
+    TypeKind getAnonymousKind(const Type* type) {
+        if (type->isScalar()) return KIND_SCALAR;
+        if (type->isString()) return KIND_STRING;
+        if (type->isHandle()) return KIND_HANDLE;
+        if (type->isMemory()) return KIND_MEMORY;
+        if (type->isPointer()) return KIND_POINTER;
+        if (type->isArray()) return KIND_ARRAY;
+        if (type->isVector()) return KIND_VECTOR;
+        if (type->isBitField()) return KIND_BIT_FIELD;
+        if (type->isTemplatedType()) {
+            return static_cast<const TemplatedType*>(type)->templatedTypeName() == "ref"
+                       ? KIND_REF
+                       : KIND_FMQ;
+        }
+        if (type->typeName() == "death recipient") return KIND_DEATH_RECIPIENT;
+
+        mOk = false;
+        return KIND_SCALAR;
+    }
+
+    void writeConstantExpression(Writer* out, const ConstantExpression* expression) {
+        if (expression == nullptr || !expression->isEvaluated()) {
+            mOk = false;
+            return;
+        }
+        out->writeInt(expression->mValueKind);
+        out->writeInt(expression->mValue);
+        out->writeString(expression->mExpr);
+        out->writeBool(expression->mTrivialDescription);
+    }
+
+    void writeAnnotations(Writer* out, const std::vector<Annotation*>& annotations) {
+        out->writeInt(annotations.size());
+        for (const Annotation* annotation : annotations) {
+            out->writeString(annotation->name());
+            out->writeInt(annotation->params().size());
+            for (const AnnotationParam* param : annotation->params()) {
+                out->writeString(param->getName());
+
+                const std::vector<const ConstantExpression*> expressions =
+                    param->getConstantExpressions();
+                out->writeBool(!expressions.empty());
+                if (!expressions.empty()) {
+                    out->writeInt(expressions.size());
+                    for (const ConstantExpression* expression : expressions) {
+                        writeConstantExpression(out, expression);
+                    }
+                } else {
+                    const std::vector<std::string> values = param->getValues();
+                    out->writeInt(values.size());
+                    for (const std::string& value : values) {
+                        out->writeString(value);
+                    }
+                }
+            }
+        }
+    }
+
+    void writeDocComment(Writer* out, const DocCommentable* commentable) {
+        const DocComment* docComment = commentable->mDocComment;
+        out->writeBool(docComment != nullptr);
+        if (docComment != nullptr) {
+            out->writeString(docComment->mComment);
+        }
+    }
+
+    void writeLocation(Writer* out, const Location& location) {
+        out->writeBool(location.isValid());
+        if (location.isValid()) {
+            writePosition(out, location.begin());
+            writePosition(out, location.end());
+        }
+    }
+
+    void writePosition(Writer* out, const Position& position) {
+        // Almost everything is in the AST's own file, which may have moved.
+        bool isOwnFile = position.filename() == mAST->getFilename();
+        out->writeBool(isOwnFile);
+        if (!isOwnFile) {
+            out->writeString(position.filename());
+        }
+        out->writeInt(position.line());
+        out->writeInt(position.column());
+    }
+
+    template <typename Names>
+    void writeNames(Writer* out, const Names& names) {
+        std::vector<std::string> sorted;
+        for (const FQName& name : names) {
+            sorted.push_back(name.string());
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        out->writeInt(sorted.size());
+        for (const std::string& name : sorted) {
+            out->writeString(name);
+        }
+        out->endRecord();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ASTCache::Deserializer {
+    Deserializer(const std::string& data, AST* ast)
+        : mIn(data), mAST(ast), mArena(&ast->getArena()) {}
+
+    bool deserialize(const std::string& key) {
+        if (mIn.readString() != kASTCacheHeader || mIn.readString() != key ||
+            mIn.readString() != getContentHash(mAST)) {
+            return false;
+        }
+
+        // Imports are done again, so that they are checked, and loaded from
+        // the cache or parsed, like those of a parsed AST.
+        if (!mAST->setPackage(mIn.readString().c_str())) {
+            return false;
+        }
+        size_t importCount = mIn.readCount();
+        for (size_t i = 0; i < importCount; i++) {
+            std::string import = mIn.readString();
+            if (!ok() || !mAST->addImport(import.c_str())) {
+                return false;
+            }
+        }
+
+        if (!readDependencies()) {
+            return false;
+        }
+
+        mTypes.push_back(&mAST->mRootScope);
+        size_t namedTypeCount = mIn.readCount();
+        for (size_t i = 0; ok() && i < namedTypeCount; i++) {
+            readNamedType();
+        }
+        size_t anonymousTypeCount = mIn.readCount();
+        for (size_t i = 0; ok() && i < anonymousTypeCount; i++) {
+            readAnonymousType();
+        }
+        for (size_t id = 1; ok() && id <= namedTypeCount; id++) {
+            readBody(mTypes[id]);
+        }
+        mAST->mRootScope.mTypeOrderChanged = mIn.readBool();
+        readNames(&mAST->mImportedNames);
+        readNames(&mAST->mReferencedTypeNames);
+
+        if (!ok() || !mIn.atEnd()) {
+            return false;
+        }
+
+        // Completes what postParse would have done.
+        for (Type* type : mTypes) {
+            type->setPostParseCompleted();
+        }
+        for (ConstantExpression* expression : mConstantExpressions) {
+            expression->setPostParseCompleted();
+        }
+        return true;
+    }
+
+   private:
+    Reader mIn;
+    AST* const mAST;
+    Arena* const mArena;
+    bool mOk = true;
+
+    std::vector<AST*> mDependencies;
+    // Indexed by the ids assigned by Serializer.
+    std::vector<Type*> mTypes;
+    std::vector<ConstantExpression*> mConstantExpressions;
+
+    bool ok() const { return mOk && mIn.ok(); }
+
+    bool readDependencies() {
+        size_t count = mIn.readCount();
+        size_t importCount = mIn.readInt();
+        if (importCount > count) {
+            return false;
+        }
+
+        std::vector<const AST*> imports;
+        for (size_t i = 0; ok() && i < count; i++) {
+            FQName fqName;
+            if (!FQName::parse(mIn.readString(), &fqName) || !fqName.isFullyQualified()) {
+                return false;
+            }
+            const std::string digest = mIn.readString();
+
+            AST* ast = mAST->mCoordinator->parse(fqName, nullptr /* parsedASTs */,
+                                                 Coordinator::Enforce::NONE);
+            if (ast == nullptr || ast->mCacheDigest.empty() || ast->mCacheDigest != digest) {
+                return false;
+            }
+            mDependencies.push_back(ast);
+            if (i < importCount) {
+                imports.push_back(ast);
+            }
+        }
+
+        // Anything else imported now was not there when the entry was written.
+        if (!ok() || std::set<const AST*>(imports.begin(), imports.end()) !=
+                         std::set<const AST*>(mAST->mImportedASTs.begin(),
+                                              mAST->mImportedASTs.end())) {
+            return false;
+        }
+
+        mAST->mCacheDigest = computeDigest(mAST, imports);
+        return true;
+    }
+
+    template <typename T>
+    T* fail() {
+        mOk = false;
+        return nullptr;
+    }
+
+    Scope* readScope() {
+        uint64_t id = mIn.readInt();
+        if (id >= mTypes.size() || !mTypes[id]->isScope()) {
+            return fail<Scope>();
+        }
+        return static_cast<Scope*>(mTypes[id]);
+    }
+
+    void readNamedType() {
+        uint64_t kind = mIn.readInt();
+        Scope* parent = readScope();
+        const std::string localName = mIn.readString();
+        const Location location = readLocation();
+        const DocComment* docComment = readDocComment();
+        if (!ok()) {
+            return;
+        }
+
+        const FQName fullName = mAST->makeFullName(localName.c_str(), parent);
+        NamedType* type;
+        switch (kind) {
+            case KIND_TYPE_DEF: {
+                type = mArena->make<TypeDef>(localName.c_str(), fullName, location, parent,
+                                             Reference<Type>());
+                break;
+            }
+            case KIND_INTERFACE: {
+                type = mArena->make<Interface>(localName.c_str(), fullName, location, parent,
+                                               Reference<Type>(), mAST->getFileHash());
+                break;
+            }
+            case KIND_ENUM: {
+                type = mArena->make<EnumType>(localName.c_str(), fullName, location,
+                                              Reference<Type>(), parent);
+                break;
+            }
+            case KIND_COMPOUND: {
+                uint64_t style = mIn.readInt();
+                if (style != CompoundType::STYLE_STRUCT && style != CompoundType::STYLE_UNION) {
+                    mOk = false;
+                    return;
+                }
+                type = mArena->make<CompoundType>(static_cast<CompoundType::Style>(style),
+                                                  localName.c_str(), fullName, location, parent);
+                break;
+            }
+            default: {
+                mOk = false;
+                return;
+            }
+        }
+
+        type->setDocComment(docComment);
+        mAST->addScopedType(type, parent);
+        mTypes.push_back(type);
+    }
+
+    void readAnonymousType() {
+        uint64_t kind = mIn.readInt();
+        Scope* parent = readScope();
+        if (!ok()) {
+            return;
+        }
+
+        Type* type;
+        switch (kind) {
+            case KIND_SCALAR: {
+                uint64_t scalarKind = mIn.readInt();
+                if (scalarKind > ScalarType::KIND_DOUBLE) {
+                    mOk = false;
+                    return;
+                }
+                type = mArena->make<ScalarType>(static_cast<ScalarType::Kind>(scalarKind), parent);
+                break;
+            }
+            case KIND_STRING: {
+                type = mArena->make<StringType>(parent);
+                break;
+            }
+            case KIND_HANDLE: {
+                type = mArena->make<HandleType>(parent);
+                break;
+            }
+            case KIND_MEMORY: {
+                type = mArena->make<MemoryType>(parent);
+                break;
+            }
+            case KIND_POINTER: {
+                type = mArena->make<PointerType>(parent);
+                break;
+            }
+            case KIND_DEATH_RECIPIENT: {
+                type = mArena->make<DeathRecipientType>(parent);
+                break;
+            }
+            case KIND_VECTOR:
+            case KIND_REF:
+            case KIND_BIT_FIELD:
+            case KIND_FMQ: {
+                TemplatedType* templatedType;
+                if (kind == KIND_VECTOR) {
+                    templatedType = mArena->make<VectorType>(parent);
+                } else if (kind == KIND_REF) {
+                    templatedType = mArena->make<RefType>(parent);
+                } else if (kind == KIND_BIT_FIELD) {
+                    templatedType = mArena->make<BitFieldType>(parent);
+                } else {
+                    const std::string nsp = mIn.readString();
+                    const std::string name = mIn.readString();
+                    templatedType = mArena->make<FmqType>(nsp.c_str(), name.c_str(), parent);
+                }
+
+                const Reference<Type> elementType = readReference();
+                if (!ok() || elementType.isEmptyReference()) {
+                    mOk = false;
+                    return;
+                }
+                templatedType->setElementType(elementType);
+                type = templatedType;
+                break;
+            }
+            case KIND_ARRAY: {
+                const Reference<Type> elementType = readReference();
+                size_t dimensions = mIn.readCount();
+                std::vector<ConstantExpression*> sizes;
+                for (size_t i = 0; ok() && i < dimensions; i++) {
+                    sizes.push_back(readConstantExpression());
+                }
+                if (!ok() || elementType.isEmptyReference() || sizes.empty()) {
+                    mOk = false;
+                    return;
+                }
+
+                ArrayType* arrayType = mArena->make<ArrayType>(elementType, sizes[0], parent);
+                for (size_t i = 1; i < sizes.size(); i++) {
+                    arrayType->appendDimension(sizes[i]);
+                }
+                type = arrayType;
+                break;
+            }
+            default: {
+                mOk = false;
+                return;
+            }
+        }
+
+        mTypes.push_back(type);
+    }
+
+    void readBody(Type* type) {
+        if (type->isTypeDef()) {
+            Reference<Type> referencedType = readReference();
+            if (referencedType.isEmptyReference()) {
+                mOk = false;
+            }
+            static_cast<TypeDef*>(type)->mReferencedType = referencedType;
+            return;
+        }
+
+        Scope* scope = static_cast<Scope*>(type);
+        scope->setAnnotations(readAnnotations());
+        scope->mTypeOrderChanged = mIn.readBool();
+
+        if (type->isInterface()) {
+            Interface* iface = static_cast<Interface*>(type);
+            iface->mSuperType = readReference();
+
+            size_t methodCount = mIn.readCount();
+            for (size_t i = 0; ok() && i < methodCount; i++) {
+                Method* method = readMethod();
+                if (method == nullptr || !iface->addMethod(method)) {
+                    mOk = false;
+                }
+            }
+            if (!ok()) {
+                return;
+            }
+
+            // As the parser does once the interface is complete.
+            const Interface* iBase = iface;
+            if (!iface->isIBase()) {
+                Type* iBaseType = mAST->lookupType(gIBaseFqName, scope);
+                if (iBaseType == nullptr || !iBaseType->isInterface() ||
+                    !static_cast<Interface*>(iBaseType)->isIBase()) {
+                    mOk = false;
+                    return;
+                }
+                iBase = static_cast<const Interface*>(iBaseType);
+            }
+            if (!iface->addAllReservedMethods(*iBase, mArena)) {
+                mOk = false;
+            }
+        } else if (type->isEnum()) {
+            EnumType* enumType = static_cast<EnumType*>(type);
+            enumType->mStorageType = readReference();
+            if (enumType->mStorageType.isEmptyReference()) {
+                mOk = false;
+            }
+
+            size_t valueCount = mIn.readCount();
+            for (size_t i = 0; ok() && i < valueCount; i++) {
+                const std::string name = mIn.readString();
+                const Location location = readLocation();
+                const DocComment* docComment = readDocComment();
+                ConstantExpression* expression = readConstantExpression();
+                bool isAutoFill = mIn.readBool();
+                if (!ok()) {
+                    return;
+                }
+
+                EnumValue* value = mArena->make<EnumValue>(name.c_str(), expression, location);
+                value->setDocComment(docComment);
+                value->mIsAutoFill = isAutoFill;
+                enumType->addValue(value);
+            }
+        } else {
+            static_cast<CompoundType*>(type)->setFields(readNamedReferences());
+        }
+    }
+
+    Method* readMethod() {
+        const std::string name = mIn.readString();
+        bool isOneway = mIn.readBool();
+        const Location location = readLocation();
+        const DocComment* docComment = readDocComment();
+        std::vector<Annotation*>* annotations = readAnnotations();
+        std::vector<NamedReference<Type>*>* args = readNamedReferences();
+        std::vector<NamedReference<Type>*>* results = readNamedReferences();
+        uint64_t serial = mIn.readInt();
+        if (!ok()) {
+            return nullptr;
+        }
+
+        Method* method =
+            mArena->make<Method>(name.c_str(), args, results, isOneway, annotations, location);
+        method->setDocComment(docComment);
+        method->setSerialId(serial);
+        return method;
+    }
+
+    std::vector<NamedReference<Type>*>* readNamedReferences() {
+        auto* references = mArena->make<std::vector<NamedReference<Type>*>>();
+        size_t count = mIn.readCount();
+        for (size_t i = 0; ok() && i < count; i++) {
+            const std::string name = mIn.readString();
+            const Reference<Type> reference = readReference();
+            const DocComment* docComment = readDocComment();
+            if (!ok() || reference.isEmptyReference()) {
+                mOk = false;
+                break;
+            }
+
+            auto* namedReference = mArena->make<NamedReference<Type>>(
+                name, reference, reference.hasLocation() ? reference.location() : Location());
+            namedReference->setDocComment(docComment);
+            references->push_back(namedReference);
+        }
+        return references;
+    }
+
+    Reference<Type> readReference() {
+        Type* type = nullptr;
+        switch (mIn.readInt()) {
+            case REFERENCE_EMPTY: {
+                return Reference<Type>();
+            }
+            case REFERENCE_LOCAL: {
+                uint64_t id = mIn.readInt();
+                if (id > 0 && id < mTypes.size()) {
+                    type = mTypes[id];
+                }
+                break;
+            }
+            case REFERENCE_IMPORTED: {
+                uint64_t dependency = mIn.readInt();
+                FQName fqName;
+                if (dependency < mDependencies.size() &&
+                    FQName::parse(mIn.readString(), &fqName)) {
+                    const auto& definedTypes = mDependencies[dependency]->mDefinedTypesByFullName;
+                    auto it = definedTypes.find(fqName);
+                    if (it != definedTypes.end()) {
+                        type = it->second;
+                    }
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+
+        const Location location = readLocation();
+        if (type == nullptr) {
+            mOk = false;
+            return Reference<Type>();
+        }
+        return Reference<Type>(type, location);
+    }
+
+    ConstantExpression* readConstantExpression() {
+        uint64_t kind = mIn.readInt();
+        uint64_t value = mIn.readInt();
+        const std::string expr = mIn.readString();
+        bool trivialDescription = mIn.readBool();
+        // The kinds LiteralConstantExpression supports.
+        if (!ok() || kind > ScalarType::KIND_UINT64) {
+            return fail<ConstantExpression>();
+        }
+
+        ConstantExpression* expression = mArena->make<LiteralConstantExpression>(
+            static_cast<ScalarType::Kind>(kind), value);
+        expression->mExpr = expr;
+        expression->mTrivialDescription = trivialDescription;
+        mConstantExpressions.push_back(expression);
+        return expression;
+    }
+
+    std::vector<Annotation*>* readAnnotations() {
+        auto* annotations = mArena->make<std::vector<Annotation*>>();
+        size_t count = mIn.readCount();
+        for (size_t i = 0; ok() && i < count; i++) {
+            const std::string name = mIn.readString();
+            auto* params = mArena->make<AnnotationParamVector>();
+            size_t paramCount = mIn.readCount();
+            for (size_t j = 0; ok() && j < paramCount; j++) {
+                const std::string paramName = mIn.readString();
+                bool hasConstantExpressions = mIn.readBool();
+                size_t valueCount = mIn.readCount();
+                if (hasConstantExpressions) {
+                    auto* values = mArena->make<std::vector<ConstantExpression*>>();
+                    for (size_t k = 0; ok() && k < valueCount; k++) {
+                        values->push_back(readConstantExpression());
+                    }
+                    params->push_back(
+                        mArena->make<ConstantExpressionAnnotationParam>(paramName, values));
+                } else {
+                    auto* values = mArena->make<std::vector<std::string>>();
+                    for (size_t k = 0; ok() && k < valueCount; k++) {
+                        values->push_back(mIn.readString());
+                    }
+                    params->push_back(mArena->make<StringAnnotationParam>(paramName, values));
+                }
+            }
+            annotations->push_back(mArena->make<Annotation>(name.c_str(), params));
+        }
+        return annotations;
+    }
+
+    const DocComment* readDocComment() {
+        if (!mIn.readBool()) {
+            return nullptr;
+        }
+        // The text is already formatted, which the constructor would do again.
+        DocComment* docComment = mArena->make<DocComment>("");
+        docComment->mComment = mIn.readString();
+        return docComment;
+    }
+
+    Location readLocation() {
+        if (!mIn.readBool()) {
+            return Location();
+        }
+        const Position begin = readPosition();
+        const Position end = readPosition();
+        return Location(begin, end);
+    }
+
+    Position readPosition() {
+        const std::string filename = mIn.readBool() ? mAST->getFilename() : mIn.readString();
+        uint64_t line = mIn.readInt();
+        uint64_t column = mIn.readInt();
+        return Position(filename, line, column);
+    }
+
+    template <typename Names>
+    void readNames(Names* names) {
+        size_t count = mIn.readCount();
+        for (size_t i = 0; ok() && i < count; i++) {
+            FQName name;
+            if (!FQName::parse(mIn.readString(), &name)) {
+                mOk = false;
+                return;
+            }
+            names->insert(name);
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ASTCache::serialize(AST* ast, const std::string& key, std::string* data) {
+    return Serializer(ast).serialize(key, data);
+}
+
+bool ASTCache::deserialize(const std::string& data, const std::string& key, AST* ast) {
+    return Deserializer(data, ast).deserialize(key);
+}
+
+}  // namespace android
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AST_CACHE_H_
+
+#define AST_CACHE_H_
+
+#include <string>
+#include <vector>
+
+namespace android {
+
+struct AST;
+
+// Persists ASTs once postParse has resolved and evaluated them, so that later
+// invocations load the files they import instead of lexing and post-parsing
+// them again. See Coordinator::setCacheDir.
+//
+// Every cached AST has a digest of its file's contents and of the digests of
+// the ASTs it imports. An entry is only used if its file and the digests of
+// the ASTs it was resolved against are unchanged, and if it was written by
+// the same hidl-gen build with the same package roots, see
+// Coordinator::getCacheKey. Imports are done again when an AST is loaded, so
+// they are themselves loaded from the cache or parsed.
+struct ASTCache {
+    // Serializes ast, which has been post-parsed, into *data. Returns false if
+    // ast cannot be cached, e.g. because one of its imports was not.
+    static bool serialize(AST* ast, const std::string& key, std::string* data);
+
+    // Restores into ast, which has only been constructed, the AST serialized
+    // in data. Returns false if the entry is stale or malformed, in which
+    // case ast is left partially restored and must be discarded.
+    static bool deserialize(const std::string& data, const std::string& key, AST* ast);
+
+   private:
+    struct Serializer;
+    struct Deserializer;
+
+    static std::string computeDigest(const AST* ast, std::vector<const AST*> imports);
+};
+
+}  // namespace android
+
+#endif  // AST_CACHE_H_
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Arena.h"
+
+#include <android-base/logging.h>
+#include <stdint.h>
+#include <string.h>
+#include <cstddef>
+
+namespace android {
+
+Arena::~Arena() {
+    for (auto it = mDestructors.rbegin(); it != mDestructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+char* Arena::copyString(const char* s) {
+    size_t size = strlen(s) + 1;
+    char* copy = static_cast<char*>(allocate(size, 1));
+    memcpy(copy, s, size);
+    return copy;
+}
+
+size_t Arena::bytesAllocated() const {
+    return mBytesAllocated;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    CHECK(alignment <= alignof(std::max_align_t)) << alignment;
+
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(mNext) % alignment) % alignment;
+
+    if (padding + size > mRemaining) {
+        // Large objects get a block of their own, so that the current block
+        // can still be filled.
+        if (size > kBlockSize / 4) {
+            mBlocks.emplace_back(new char[size]);
+            mBytesAllocated += size;
+            return mBlocks.back().get();
+        }
+
+        mBlocks.emplace_back(new char[kBlockSize]);
+        mNext = mBlocks.back().get();
+        mRemaining = kBlockSize;
+        padding = 0;
+    }
+
+    void* memory = mNext + padding;
+    mNext += padding + size;
+    mRemaining -= padding + size;
+    mBytesAllocated += size;
+    return memory;
+}
+
+}  // namespace android
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ARENA_H_
+
+#define ARENA_H_
+
+#include <android-base/macros.h>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+// Bump allocator for the nodes of one AST. Objects are packed into large
+// blocks in allocation order, and all of them are destroyed, in reverse
+// order, together with the Arena. Objects must not be deleted individually.
+// Not thread-safe.
+struct Arena {
+    Arena() = default;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args);
+
+    // Returns a copy of the NUL-terminated string s.
+    char* copyString(const char* s);
+
+    // Bytes handed out so far.
+    size_t bytesAllocated() const;
+
+   private:
+    static constexpr size_t kBlockSize = 32 * 1024;
+
+    struct Destructor {
+        void (*destroy)(void* object);
+        void* object;
+    };
+
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    char* mNext = nullptr;
+    size_t mRemaining = 0;
+    size_t mBytesAllocated = 0;
+
+    std::vector<Destructor> mDestructors;
+
+    void* allocate(size_t size, size_t alignment);
+
+    DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+template <typename T, typename... Args>
+T* Arena::make(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+        mDestructors.push_back({[](void* o) { static_cast<T*>(o)->~T(); }, object});
+    }
+    return object;
+}
+
+}  // namespace android
+
+#endif  // ARENA_H_
@@ -41,6 +41,28 @@ bool ArrayType::isArray() const {
     return true;
 }
 
+std::string ArrayType::getCppHashExpression(const std::string& name, size_t depth) const {
+    const std::string hash = "_hidl_hash_" + std::to_string(depth);
+    const std::string index = "_hidl_index_" + std::to_string(depth);
+    return "[&] { size_t " + hash + " = 0; for (size_t " + index + " = 0; " + index + " < " +
+           std::to_string(dimension()) + "; ++" + index + ") { " + hash + " = " + hash +
+           " * 31 + " +
+           mElementType->getCppHashExpression(name + ".data()[" + index + "]", depth + 1) +
+           "; } return " + hash + "; }()";
+}
+
+void ArrayType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                     size_t depth) const {
+    const std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < " << dimension()
+        << "; ++" << iteratorName << ") ";
+    out.block([&] {
+        mElementType->emitCppBenchmarkFill(out, name + ".data()[" + iteratorName + "]",
+                                           depth + 1);
+    }).endl();
+}
+
 bool ArrayType::deepCanCheckEquality(std::unordered_set<const Type*>* visited) const {
     return mElementType->canCheckEquality(visited);
 }
@@ -370,6 +392,30 @@ void ArrayType::emitJavaDump(
 }
 
 
+std::string ArrayType::getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                         size_t depth) const {
+    if (!mElementType->needsEmbeddedReadWrite()) {
+        return "0";
+    }
+
+    const std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    return "[&] { size_t _hidl_size = 0; for (size_t " + iteratorName + " = 0; " +
+           iteratorName + " < " + std::to_string(dimension()) + "; ++" + iteratorName +
+           ") { _hidl_size += " +
+           mElementType->getCppEstimatedEmbeddedParcelSize(
+                   name + ".data()[" + iteratorName + "]", depth + 1) +
+           "; } return _hidl_size; }()";
+}
+
+void ArrayType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    MarshalCost element;
+    element.inProgress = cost->inProgress;
+    mElementType->addEmbeddedMarshalCost(&element, level);
+
+    cost->addRepeated(element, dimension());
+}
+
 bool ArrayType::needsEmbeddedReadWrite() const {
     return mElementType->needsEmbeddedReadWrite();
 }
@@ -32,6 +32,9 @@ struct ArrayType : public Type {
 
     bool isArray() const override;
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     const Type* getElementType() const;
 
@@ -109,6 +112,9 @@ struct ArrayType : public Type {
             const std::string &name) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                  size_t depth) const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
 
@@ -143,6 +149,8 @@ struct ArrayType : public Type {
 
     size_t dimension() const;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(ArrayType);
 };
 
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CACHED_STRING_H_
+
+#define CACHED_STRING_H_
+
+#include <android-base/macros.h>
+#include <atomic>
+#include <string>
+
+namespace android {
+
+// A string which is computed the first time it is needed and kept afterwards.
+// Imported types are shared between ASTs generated on different threads, so
+// the first get() may race: every racer computes the same value, one of them
+// is published and the others are dropped.
+struct CachedString {
+    CachedString() = default;
+
+    ~CachedString() { delete mValue.load(std::memory_order_relaxed); }
+
+    template <typename Compute>
+    const std::string& get(const Compute& compute) const {
+        const std::string* value = mValue.load(std::memory_order_acquire);
+        if (value == nullptr) {
+            const std::string* computed = new std::string(compute());
+            if (mValue.compare_exchange_strong(value, computed, std::memory_order_acq_rel)) {
+                value = computed;
+            } else {
+                delete computed;
+            }
+        }
+        return *value;
+    }
+
+   private:
+    mutable std::atomic<const std::string*> mValue{nullptr};
+
+    DISALLOW_COPY_AND_ASSIGN(CachedString);
+};
+
+}  // namespace android
+
+#endif  // CACHED_STRING_H_
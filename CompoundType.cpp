@@ -17,6 +17,7 @@
 #include "CompoundType.h"
 
 #include "ArrayType.h"
+#include "ScalarType.h"
 #include "VectorType.h"
 
 #include <android-base/logging.h>
@@ -454,6 +455,105 @@ void CompoundType::emitTypeDeclarations(Formatter& out) const {
         << ", \"wrong alignment\");\n\n";
 }
 
+void CompoundType::emitGlobalTypeDeclarations(Formatter& out) const {
+    Scope::emitGlobalTypeDeclarations(out);
+
+    if (!canCheckEquality()) {
+        return;
+    }
+
+    // operator() is defined by emitGlobalTypeDefinitions, once every
+    // specialization in the file is declared; fields may refer to structs
+    // declared after this one.
+    out << "namespace std {\n\n";
+    out << "template<>\n";
+    out << "struct hash<" << fullName() << "> ";
+    out.block([&] { out << "size_t operator()(const " << fullName() << " &o) const;\n"; });
+    out << ";\n\n";
+    out << "}  // namespace std\n\n";
+}
+
+void CompoundType::emitGlobalTypeDefinitions(Formatter& out) const {
+    Scope::emitGlobalTypeDefinitions(out);
+
+    if (!canCheckEquality()) {
+        return;
+    }
+
+    out << "namespace std {\n\n";
+    out << "inline size_t hash<" << fullName() << ">::operator()(const " << fullName() << " &"
+        << (mFields->empty() ? "/* o */" : "o") << ") const ";
+    out.block([&] {
+        if (isByteComparable()) {
+            size_t align, size;
+            getAlignmentAndSize(&align, &size);
+            const size_t words = (size + 7) / 8;
+            out << "static_assert(sizeof(" << fullName() << ") == " << size << ", \""
+                << localName() << " must not have padding\");\n";
+            // Independent per-word terms, so the loop vectorizes.
+            out << "uint64_t _hidl_words[" << words << "] = {};\n";
+            out << "std::memcpy(_hidl_words, &o, sizeof(" << fullName() << "));\n";
+            out << "uint64_t _hidl_hash = 0;\n";
+            out << "for (size_t _hidl_index = 0; _hidl_index < " << words << "; ++_hidl_index) ";
+            out.block([&] {
+                out << "_hidl_hash += (_hidl_words[_hidl_index] ^ "
+                    << "(_hidl_index * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;\n";
+            }).endl();
+            out << "return static_cast<size_t>(_hidl_hash ^ (_hidl_hash >> 32));\n";
+            return;
+        }
+        out << "size_t _hidl_hash = 0;\n";
+        for (const auto& field : *mFields) {
+            out << "_hidl_hash = _hidl_hash * 31 + "
+                << field->type().getCppHashExpression("o." + field->name(), 0 /* depth */)
+                << ";\n";
+        }
+        out << "return _hidl_hash;\n";
+    }).endl();
+    out << "\n}  // namespace std\n\n";
+}
+
+std::string CompoundType::getCppHashExpression(const std::string& name,
+                                               size_t /* depth */) const {
+    return "std::hash<" + fullName() + ">()(" + name + ")";
+}
+
+void CompoundType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                        size_t depth) const {
+    for (const auto& field : *mFields) {
+        field->type().emitCppBenchmarkFill(out, name + "." + field->name(), depth);
+
+        // Only one member of a union may be set.
+        if (mStyle == STYLE_UNION) {
+            break;
+        }
+    }
+}
+
+bool CompoundType::isByteComparable() const {
+    if (mStyle != STYLE_STRUCT || mFields->empty()) {
+        return false;
+    }
+
+    size_t fieldsSize = 0;
+    for (const auto& field : *mFields) {
+        // Floating point equality is not bitwise: -0.0 == 0.0 and NaN != NaN.
+        const ScalarType* scalarType = field->type().resolveToScalarType();
+        if (scalarType == nullptr || scalarType->getKind() == ScalarType::KIND_FLOAT ||
+            scalarType->getKind() == ScalarType::KIND_DOUBLE) {
+            return false;
+        }
+
+        size_t fieldAlign, fieldSize;
+        field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+        fieldsSize += fieldSize;
+    }
+
+    size_t align, size;
+    getAlignmentAndSize(&align, &size);
+    return fieldsSize == size;
+}
+
 void CompoundType::emitTypeForwardDeclaration(Formatter& out) const {
     out << ((mStyle == STYLE_STRUCT) ? "struct" : "union") << " " << localName() << ";\n";
 }
@@ -489,6 +589,14 @@ void CompoundType::emitPackageTypeDeclarations(Formatter& out) const {
             << getCppArgumentType() << " " << (mFields->empty() ? "/* lhs */" : "lhs") << ", "
             << getCppArgumentType() << " " << (mFields->empty() ? "/* rhs */" : "rhs") << ") ";
         out.block([&] {
+            if (isByteComparable()) {
+                size_t align, size;
+                getAlignmentAndSize(&align, &size);
+                out << "static_assert(sizeof(" << fullName() << ") == " << size
+                    << ", \"" << localName() << " must not have padding\");\n";
+                out << "return std::memcmp(&lhs, &rhs, sizeof(" << fullName() << ")) == 0;\n";
+                return;
+            }
             for (const auto &field : *mFields) {
                 out.sIf("lhs." + field->name() + " != rhs." + field->name(), [&] {
                     out << "return false;\n";
@@ -530,6 +638,8 @@ void CompoundType::emitPackageHwDeclarations(Formatter& out) const {
             << "size_t parentOffset);\n\n";
 
         out.unindent(2);
+
+        out << "size_t getEstimatedEmbeddedParcelSize(const " << fullName() << " &obj);\n\n";
     }
 
     if(needsResolveReferences()) {
@@ -555,6 +665,7 @@ void CompoundType::emitTypeDefinitions(Formatter& out, const std::string& prefix
     if (needsEmbeddedReadWrite()) {
         emitStructReaderWriter(out, prefix, true /* isReader */);
         emitStructReaderWriter(out, prefix, false /* isReader */);
+        emitEstimatedParcelSizeDef(out, prefix);
     }
 
     if (needsResolveReferences()) {
@@ -949,6 +1060,54 @@ void CompoundType::emitResolveReferenceDef(Formatter& out, const std::string& pr
     out << "}\n\n";
 }
 
+void CompoundType::emitEstimatedParcelSizeDef(Formatter& out, const std::string& prefix) const {
+    std::string space = prefix.empty() ? "" : (prefix + "::");
+
+    out << "size_t getEstimatedEmbeddedParcelSize(const " << space << localName()
+        << " &obj) {\n";
+    out.indent();
+    out << "size_t _hidl_size = 0;\n";
+
+    for (const auto& field : *mFields) {
+        if (!field->type().needsEmbeddedReadWrite()) {
+            continue;
+        }
+
+        out << "_hidl_size += "
+            << field->type().getCppEstimatedEmbeddedParcelSize("obj." + field->name(),
+                                                               0 /* depth */)
+            << ";\n";
+    }
+
+    out << "return _hidl_size;\n";
+    out.unindent();
+    out << "}\n\n";
+}
+
+std::string CompoundType::getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                            size_t /* depth */) const {
+    if (!needsEmbeddedReadWrite()) {
+        return "0";
+    }
+    return "getEstimatedEmbeddedParcelSize(" + name + ")";
+}
+
+void CompoundType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    if (!needsEmbeddedReadWrite()) {
+        return;
+    }
+
+    // Fields live in the same buffer as the struct itself.
+    if (!cost->inProgress.insert(this).second) {
+        cost->recursive = true;
+        return;
+    }
+    for (const auto& field : *mFields) {
+        field->type().addEmbeddedMarshalCost(cost, level);
+    }
+    cost->inProgress.erase(this);
+}
+
 bool CompoundType::needsEmbeddedReadWrite() const {
     if (mStyle != STYLE_STRUCT) {
         return false;
@@ -41,6 +41,9 @@ struct CompoundType : public Scope {
     bool isCompoundType() const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     std::string typeName() const override;
 
@@ -121,12 +124,17 @@ struct CompoundType : public Scope {
     void emitTypeForwardDeclaration(Formatter& out) const override;
     void emitPackageTypeDeclarations(Formatter& out) const override;
     void emitPackageHwDeclarations(Formatter& out) const override;
+    void emitGlobalTypeDeclarations(Formatter& out) const override;
+    void emitGlobalTypeDefinitions(Formatter& out) const override;
 
     void emitTypeDefinitions(Formatter& out, const std::string& prefix) const override;
 
     void emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                  size_t depth) const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
 
@@ -146,6 +154,13 @@ private:
     void emitStructReaderWriter(
             Formatter &out, const std::string &prefix, bool isReader) const;
     void emitResolveReferenceDef(Formatter& out, const std::string& prefix, bool isReader) const;
+    void emitEstimatedParcelSizeDef(Formatter& out, const std::string& prefix) const;
+
+    // True for a struct of integral and enum fields without padding, whose
+    // bytes can be compared and hashed directly.
+    bool isByteComparable() const;
+
+    friend struct ASTCache;
 
     DISALLOW_COPY_AND_ASSIGN(CompoundType);
 };
@@ -400,7 +400,8 @@ std::string ConstantExpression::cppValue(ScalarType::Kind castKind) const {
     // be narrowed to int64_t.
     if(castKind == SK(INT64) && (int64_t)mValue == INT64_MIN) {
         return "static_cast<" +
-               ScalarType(SK(INT64), nullptr /* parent */).getCppStackType()  // "int64_t"
+               ScalarType(SK(INT64), nullptr /* parent */)
+                   .getCppType(Type::StorageMode_Stack, true /* specifyNamespaces */)  // "int64_t"
                + ">(" + literal + "ull)";
     }
 
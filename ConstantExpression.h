@@ -147,6 +147,7 @@ struct ConstantExpression {
     template <typename T>
     T cast() const;
 
+    friend struct ASTCache;
     friend struct LiteralConstantExpression;
     friend struct UnaryConstantExpression;
     friend struct BinaryConstantExpression;
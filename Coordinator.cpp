@@ -17,9 +17,14 @@
 #include "Coordinator.h"
 
 #include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
 #include <sys/stat.h>
 
+#include <unistd.h>
+
 #include <algorithm>
+#include <fstream>
 #include <iterator>
 
 #include <android-base/logging.h>
@@ -29,7 +34,11 @@
 #include <cstring>
 
 #include "AST.h"
+#include "ASTCache.h"
 #include "Interface.h"
+#include "Location.h"
+#include "ThreadPool.h"
+#include "TimeReport.h"
 #include "hidl-gen_l.h"
 
 static bool existdir(const char *name) {
@@ -43,6 +52,77 @@ static bool existdir(const char *name) {
 
 namespace android {
 
+// Set on prefetch worker threads. Every AST parsed there is a prefetched one.
+static thread_local bool tIsPrefetching = false;
+
+// The fqNames this thread is parsing, innermost last.
+static thread_local std::vector<FQName> tParseStack;
+
+// Must change whenever the rules checked by enforceRestrictionsOnPackage
+// change. Entries are also tied to one build, see getCacheKey.
+static const std::string kEnforcementCacheHeader = "hidl-gen enforcement cache 2";
+
+// Sorted .hal files in a directory, or "-" if it doesn't exist.
+static std::string dirSignature(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return "-";
+    }
+
+    std::vector<std::string> names;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        if (ent->d_type == DT_REG && StringHelper::EndsWith(ent->d_name, ".hal")) {
+            names.push_back(ent->d_name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    return "[" + StringHelper::JoinStrings(names, ",") + "]";
+}
+
+// Hash of a file's contents, or "-" if it doesn't exist.
+static std::string fileSignature(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return "-";
+    }
+    return Hash::hexString(Hash::computeHash(path));
+}
+
+// Hashes of the files this hidl-gen was loaded from: the parser and the
+// caches, and the AST node classes, which may live in another library.
+// Empty if they cannot be found.
+static const std::string& getBuildId() {
+    static const std::string buildId = [] {
+        const void* const addresses[] = {
+            reinterpret_cast<const void*>(&getBuildId),
+            reinterpret_cast<const void*>(&Location::startOf),
+        };
+
+        std::set<std::string> files;
+        for (const void* address : addresses) {
+            Dl_info info;
+            if (dladdr(address, &info) == 0 || info.dli_fname == nullptr) {
+                return std::string();
+            }
+            files.insert(info.dli_fname);
+        }
+
+        std::vector<std::string> signatures;
+        for (const std::string& file : files) {
+            const std::string signature = fileSignature(file);
+            if (signature == "-") {
+                return std::string();
+            }
+            signatures.push_back(signature);
+        }
+        return StringHelper::JoinStrings(signatures, ",");
+    }();
+    return buildId;
+}
+
 const std::string &Coordinator::getRootPath() const {
     return mRootPath;
 }
@@ -71,6 +151,35 @@ void Coordinator::setDepFile(const std::string& depFile) {
     mDepFile = depFile;
 }
 
+Coordinator::Coordinator() {}
+
+Coordinator::~Coordinator() {}
+
+void Coordinator::setJobs(size_t jobs) {
+    CHECK(mPrefetchPool == nullptr);
+
+    mJobs = jobs;
+    if (jobs > 1) {
+        mPrefetchPool = std::make_unique<ThreadPool>(jobs - 1);
+    }
+}
+
+size_t Coordinator::getJobs() const {
+    return mJobs;
+}
+
+void Coordinator::setWriteOnlyIfChanged(bool writeOnlyIfChanged) {
+    mWriteOnlyIfChanged = writeOnlyIfChanged;
+}
+
+void Coordinator::setCacheDir(const std::string& cacheDir) {
+    mCacheDir = cacheDir;
+
+    if (!mCacheDir.empty() && !StringHelper::EndsWith(mCacheDir, "/")) {
+        mCacheDir += "/";
+    }
+}
+
 const std::string& Coordinator::getOwner() const {
     return mOwner;
 }
@@ -119,6 +228,15 @@ Formatter Coordinator::getFormatter(const FQName& fqName, Location location,
         return Formatter::invalid();
     }
 
+    if (mWriteOnlyIfChanged) {
+        Formatter out = Formatter::forFileIfChanged(filepath);
+        if (!out.isValid()) {
+            fprintf(stderr, "ERROR: could not create a temporary file for %s.\n",
+                    filepath.c_str());
+        }
+        return out;
+    }
+
     FILE* file = fopen(filepath.c_str(), "w");
 
     if (file == nullptr) {
@@ -174,6 +292,7 @@ void Coordinator::onFileAccess(const std::string& path, const std::string& mode)
         // 1). If there is a bug in hidl-gen, the dependencies on the first project from
         //     the second would be required to recover correctly when the bug is fixed.
         // 2). This option is never used in Android builds.
+        std::lock_guard<std::mutex> lock(mMutex);
         mReadFiles.insert(StringHelper::LTrim(path, mRootPath));
     }
 
@@ -197,6 +316,8 @@ status_t Coordinator::writeDepFile(const std::string& forFile) const {
         return UNKNOWN_ERROR;
     }
 
+    std::lock_guard<std::mutex> lock(mMutex);
+
     Formatter out(file, 2 /* spacesPerIndent */);
     out << StringHelper::LTrim(forFile, mOutputPath) << ": \\\n";
     out.indent([&] {
@@ -223,24 +344,185 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
                                     Enforce enforcement) const {
     CHECK(fqName.isFullyQualified());
 
-    auto it = mCache.find(fqName);
-    if (it != mCache.end()) {
-        *ast = (*it).second;
+    *ast = nullptr;
+    bool claimed = false;
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
 
-        if (*ast != nullptr && parsedASTs != nullptr) {
-            parsedASTs->insert(*ast);
+        if (!tParseStack.empty()) {
+            mCache.at(tParseStack.back()).imports.push_back(fqName);
         }
 
-        if (*ast == nullptr) {
-            // circular import OR that AST has errors in it
-            return UNKNOWN_ERROR;
+        for (auto it = mCache.find(fqName); it != mCache.end(); it = mCache.find(fqName)) {
+            const CacheEntry& entry = it->second;
+
+            if (!entry.done) {
+                if (entry.owner == std::this_thread::get_id() ||
+                    isWaitingOnThisThread(entry.owner)) {
+                    // circular import
+                    return UNKNOWN_ERROR;
+                }
+
+                // being parsed by another thread
+                mWaitingFor[std::this_thread::get_id()] = fqName;
+                mCacheChanged.wait(lock);
+                mWaitingFor.erase(std::this_thread::get_id());
+                continue;
+            }
+
+            if (entry.prefetched && !tIsPrefetching) {
+                claimPrefetched(fqName);
+                claimed = true;
+            }
+
+            *ast = entry.ast;
+
+            if (*ast == nullptr) {
+                // that AST has errors in it
+                return UNKNOWN_ERROR;
+            }
+
+            if (parsedASTs != nullptr) {
+                parsedASTs->insert(*ast);
+            }
+
+            if (!claimed) {
+                return OK;
+            }
+            break;
+        }
+
+        if (!claimed) {
+            // Add this to the cache immediately, so we can discover circular imports.
+            CacheEntry& entry = mCache[fqName];
+            entry.owner = std::this_thread::get_id();
+            entry.prefetched = tIsPrefetching;
         }
+    }
+
+    if (claimed) {
+        // Parsed by prefetch(), do what parsing it now would have done.
+        return enforceParsed(fqName, ast, enforcement);
+    }
 
+    status_t err;
+    tParseStack.push_back(fqName);
+    err = parseUncached(fqName, ast);
+    tParseStack.pop_back();
+
+    if (err == OK && *ast == nullptr) {
+        // File does not exist, nullptr AST* == file doesn't exist.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCache.erase(fqName);  // pending entry in cache is used to find circular imports
+        mCacheChanged.notify_all();
         return OK;
     }
 
-    // Add this to the cache immediately, so we can discover circular imports.
-    mCache[fqName] = nullptr;
+    // put it into the cache now, so that enforceRestrictionsOnPackage can
+    // parse fqName.
+    finishCacheEntry(fqName, *ast);
+    if (err != OK) {
+        return err;
+    }
+
+    if (parsedASTs != nullptr) {
+        parsedASTs->insert(*ast);
+    }
+
+    return enforceParsed(fqName, ast, enforcement);
+}
+
+status_t Coordinator::enforceParsed(const FQName& fqName, AST** ast, Enforce enforcement) const {
+    // For each .hal file that hidl-gen parses, the whole package will be checked.
+    status_t err = enforceRestrictionsOnPackage(fqName, enforcement);
+    if (err != OK) {
+        // Not deleted, it may have been imported by another thread already.
+        finishCacheEntry(fqName, nullptr);
+        *ast = nullptr;
+        return err;
+    }
+
+    return OK;
+}
+
+void Coordinator::finishCacheEntry(const FQName& fqName, AST* ast) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    CacheEntry& entry = mCache.at(fqName);
+    entry.ast = ast;
+    entry.done = true;
+    if (ast != nullptr) {
+        mASTs.emplace_back(ast);
+    }
+    mCacheChanged.notify_all();
+}
+
+bool Coordinator::isWaitingOnThisThread(std::thread::id thread) const {
+    // Follow what each thread is waiting for. Every thread waits for at most
+    // one other thread, so this either ends or comes back to this thread.
+    for (size_t i = 0; i <= mWaitingFor.size(); i++) {
+        if (thread == std::this_thread::get_id()) {
+            return true;
+        }
+
+        auto waiting = mWaitingFor.find(thread);
+        if (waiting == mWaitingFor.end()) {
+            return false;
+        }
+
+        const CacheEntry& entry = mCache.at(waiting->second);
+        if (entry.done) {
+            return false;  // about to wake up
+        }
+        thread = entry.owner;
+    }
+    return false;
+}
+
+void Coordinator::claimPrefetched(const FQName& fqName) const {
+    // The first parse() of a prefetched AST stands for parsing it, and so for
+    // parsing its imports too, without enforcement.
+    std::vector<FQName> todo = {fqName};
+    while (!todo.empty()) {
+        auto it = mCache.find(todo.back());
+        todo.pop_back();
+
+        if (it == mCache.end() || !it->second.prefetched) {
+            continue;
+        }
+
+        it->second.prefetched = false;
+        todo.insert(todo.end(), it->second.imports.begin(), it->second.imports.end());
+    }
+}
+
+void Coordinator::prefetch(const std::vector<FQName>& fqNames) const {
+    if (mPrefetchPool == nullptr) {
+        return;
+    }
+
+    for (const FQName& fqName : fqNames) {
+        if (!fqName.isFullyQualified()) {
+            continue;
+        }
+
+        mPrefetchPool->enqueue([this, fqName] {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mCache.find(fqName) != mCache.end()) {
+                    return;  // already parsed or being parsed
+                }
+            }
+
+            tIsPrefetching = true;
+            AST* ast;
+            parseOptional(fqName, &ast, nullptr /* parsedASTs */, Enforce::NONE);
+        });
+    }
+}
+
+status_t Coordinator::parseUncached(const FQName& fqName, AST** ast) const {
+    TimeReport::Phase phase("parse", fqName.string());
 
     AST *typesAST = nullptr;
 
@@ -261,30 +543,42 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
 
     const std::string path = makeAbsolute(packagePath + fqName.name() + ".hal");
 
-    *ast = new AST(this, &Hash::getHash(path));
-
-    if (typesAST != NULL) {
-        // If types.hal for this AST's package existed, make it's defined
-        // types available to the (about to be parsed) AST right away.
-        (*ast)->addImportedAST(typesAST);
-    }
-
-    std::unique_ptr<FILE, std::function<void(FILE*)>> file(fopen(path.c_str(), "rb"), fclose);
+    std::unique_ptr<SourceFile> file = SourceFile::open(path);
 
     if (file == nullptr) {
-        mCache.erase(fqName);  // nullptr in cache is used to find circular imports
-        delete *ast;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mProbedFiles.insert(StringHelper::LTrim(path, mRootPath));
+        }
         *ast = nullptr;
         return OK;  // File does not exist, nullptr AST* == file doesn't exist.
     }
 
     onFileAccess(path, "r");
 
-    // parse file takes ownership of file
-    if (parseFile(*ast, std::move(file)) != OK || (*ast)->postParse() != OK) {
-        delete *ast;
-        *ast = nullptr;
-        return UNKNOWN_ERROR;
+    // Hashed from the mapping that is lexed below, before the lexer writes
+    // into it, so that the hash is that of the parsed contents.
+    *ast = new AST(this, &Hash::getHash(*file));
+
+    if (typesAST != NULL) {
+        // If types.hal for this AST's package existed, make it's defined
+        // types available to the (about to be parsed) AST right away.
+        (*ast)->addImportedAST(typesAST);
+    }
+
+    if (!loadCachedAST(fqName, ast, typesAST)) {
+        status_t parseErr;
+        {
+            TimeReport::Phase parseFilePhase("parseFile", fqName.string());
+            parseErr = parseFile(*ast, file.get());
+        }
+        if (parseErr != OK || (*ast)->postParse() != OK) {
+            delete *ast;
+            *ast = nullptr;
+            return UNKNOWN_ERROR;
+        }
+
+        cacheAST(fqName, *ast);
     }
 
     if ((*ast)->package().package() != fqName.package() ||
@@ -337,23 +631,6 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
         return err;
     }
 
-    if (parsedASTs != nullptr) {
-        parsedASTs->insert(*ast);
-    }
-
-    // put it into the cache now, so that enforceRestrictionsOnPackage can
-    // parse fqName.
-    mCache[fqName] = *ast;
-
-    // For each .hal file that hidl-gen parses, the whole package will be checked.
-    err = enforceRestrictionsOnPackage(fqName, enforcement);
-    if (err != OK) {
-        mCache[fqName] = nullptr;
-        delete *ast;
-        *ast = nullptr;
-        return err;
-    }
-
     return OK;
 }
 
@@ -451,6 +728,10 @@ status_t Coordinator::getPackageInterfaceFiles(
     if (err != OK) return err;
 
     const std::string path = makeAbsolute(packagePath);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReadDirs.insert(StringHelper::LTrim(path, mRootPath));
+    }
     DIR* dir = opendir(path.c_str());
 
     if (dir == NULL) {
@@ -554,6 +835,7 @@ status_t Coordinator::addUnreferencedTypes(const std::vector<FQName>& packageInt
     std::set<FQName> packageImportedTypes;
     std::set<FQName> typesDefinedTypes;  // only types.hal types
 
+    prefetch(packageInterfaces);
     for (const auto& fqName : packageInterfaces) {
         AST* ast = parse(fqName);
         if (!ast) {
@@ -624,20 +906,35 @@ status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
     }
 
     FQName package = fqName.getPackageAndVersion();
-    // look up cache.
-    if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
+    size_t firstClearedHash;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // look up cache.
+        if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
+            return OK;
+        }
+        firstClearedHash = mClearedHashes.size();
+    }
+
+    if (isEnforcementCached(package, enforcement)) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPackagesEnforced.insert(package);
         return OK;
     }
 
     // enforce all rules.
     status_t err;
 
-    err = enforceMinorVersionUprevs(package, enforcement);
+    {
+        TimeReport::Phase phase("enforceMinorVersionUprevs", package.string());
+        err = enforceMinorVersionUprevs(package, enforcement);
+    }
     if (err != OK) {
         return err;
     }
 
     if (enforcement != Enforce::NO_HASH) {
+        TimeReport::Phase phase("enforceHashes", package.string());
         err = enforceHashes(package);
         if (err != OK) {
             return err;
@@ -645,10 +942,241 @@ status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
     }
 
     // cache it so that it won't need to be enforced again.
-    mPackagesEnforced.insert(package);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPackagesEnforced.insert(package);
+    }
+    cacheEnforcement(package, enforcement, firstClearedHash);
     return OK;
 }
 
+std::string Coordinator::getCacheKey() const {
+    const std::string& buildId = getBuildId();
+    if (buildId.empty()) {
+        static std::once_flag warned;
+        std::call_once(warned, [] {
+            fprintf(stderr, "WARNING: could not identify this hidl-gen build, not using the cache.\n");
+        });
+        return "";
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        return "";
+    }
+
+    // Where each package root is actually found, whether mRootPath and the
+    // paths given with -r are absolute or not.
+    const auto resolve = [&](const std::string& path) {
+        return StringHelper::StartsWith(path, "/") ? path : std::string(cwd) + "/" + path;
+    };
+
+    std::vector<std::string> roots;
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        roots.push_back(packageRoot.root.package() + "=" +
+                        resolve(makeAbsolute(packageRoot.path)));
+    }
+    std::sort(roots.begin(), roots.end());
+
+    return "build " + buildId + " root " + resolve(mRootPath) + " packages " +
+           StringHelper::JoinStrings(roots, ",");
+}
+
+void Coordinator::writeCacheFile(const std::string& cachePath,
+                                 const std::string& contents) const {
+    // Written to a temporary file first, so that no reader sees a partial
+    // entry. Failing to write it only costs time in the next invocation.
+    const std::string tmpPath = cachePath + ".tmp" + std::to_string(getpid());
+
+    onFileAccess(cachePath, "w");
+
+    if (!Coordinator::MakeParentHierarchy(cachePath)) {
+        fprintf(stderr, "WARNING: could not make directories for %s.\n", cachePath.c_str());
+        return;
+    }
+
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "WARNING: could not open cache file %s: %d\n", tmpPath.c_str(), errno);
+        return;
+    }
+
+    Formatter out(file);
+    out << contents;
+    if (!out.close()) {
+        fprintf(stderr, "WARNING: could not write cache file %s: %d\n", tmpPath.c_str(), errno);
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    if (rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        fprintf(stderr, "WARNING: could not write cache file %s: %d\n", cachePath.c_str(), errno);
+        unlink(tmpPath.c_str());
+    }
+}
+
+std::string Coordinator::getASTCachePath(const FQName& fqName) const {
+    return mCacheDir + "ast/" + fqName.string();
+}
+
+bool Coordinator::loadCachedAST(const FQName& fqName, AST** ast, AST* typesAST) const {
+    if (mCacheDir.empty()) return false;
+
+    const std::string key = getCacheKey();
+    if (key.empty()) return false;
+
+    const std::string cachePath = getASTCachePath(fqName);
+    std::ifstream stream(cachePath, std::ios::binary);
+    if (!stream) return false;
+    const std::string data{std::istreambuf_iterator<char>(stream),
+                           std::istreambuf_iterator<char>()};
+
+    TimeReport::Phase phase("loadCachedAST", fqName.string());
+
+    if (ASTCache::deserialize(data, key, *ast)) {
+        if (mVerbose) {
+            fprintf(stderr, "VERBOSE: using cached AST %s\n", cachePath.c_str());
+        }
+        return true;
+    }
+
+    // Parse into an AST nothing was restored into.
+    const Hash* fileHash = (*ast)->getFileHash();
+    delete *ast;
+    *ast = new AST(this, fileHash);
+    if (typesAST != nullptr) {
+        (*ast)->addImportedAST(typesAST);
+    }
+    return false;
+}
+
+void Coordinator::cacheAST(const FQName& fqName, AST* ast) const {
+    if (mCacheDir.empty()) return;
+
+    const std::string key = getCacheKey();
+    if (key.empty()) return;
+
+    TimeReport::Phase phase("cacheAST", fqName.string());
+
+    std::string data;
+    if (!ASTCache::serialize(ast, key, &data)) {
+        return;
+    }
+    writeCacheFile(getASTCachePath(fqName), data);
+}
+
+std::string Coordinator::getEnforcementCachePath(const FQName& package,
+                                                 Enforce enforcement) const {
+    return mCacheDir + package.string() + (enforcement == Enforce::NO_HASH ? ".nohash" : ".full");
+}
+
+bool Coordinator::isEnforcementCached(const FQName& package, Enforce enforcement) const {
+    if (mCacheDir.empty()) return false;
+
+    const std::string key = getCacheKey();
+    if (key.empty()) return false;
+
+    const std::string cachePath = getEnforcementCachePath(package, enforcement);
+    std::ifstream stream(cachePath);
+    std::string line;
+    if (!std::getline(stream, line) || line != kEnforcementCacheHeader) {
+        return false;
+    }
+    if (!std::getline(stream, line) || line != key) {
+        return false;
+    }
+
+    // Each line is "<kind> <signature> <path>". Everything is validated
+    // before anything is replayed so that a stale entry has no effect.
+    struct Entry {
+        std::string kind;
+        std::string signature;
+        std::string path;
+    };
+    std::vector<Entry> entries;
+    while (std::getline(stream, line)) {
+        const size_t kindEnd = line.find(' ');
+        if (kindEnd == std::string::npos) return false;
+        const size_t signatureEnd = line.find(' ', kindEnd + 1);
+        if (signatureEnd == std::string::npos) return false;
+
+        Entry entry{line.substr(0, kindEnd),
+                    line.substr(kindEnd + 1, signatureEnd - kindEnd - 1),
+                    line.substr(signatureEnd + 1)};
+
+        if (entry.kind == "dir") {
+            if (dirSignature(makeAbsolute(entry.path)) != entry.signature) return false;
+        } else if (entry.kind == "file") {
+            if (fileSignature(makeAbsolute(entry.path)) != entry.signature) return false;
+        } else if (entry.kind != "clear") {
+            return false;
+        }
+
+        entries.push_back(std::move(entry));
+    }
+
+    if (mVerbose) {
+        fprintf(stderr, "VERBOSE: using cached enforcement %s\n", cachePath.c_str());
+    }
+
+    // Replay what running the enforcement would have done, so that the
+    // depfile and later cache entries still see these inputs.
+    for (const Entry& entry : entries) {
+        if (entry.kind == "file" && entry.signature != "-") {
+            onFileAccess(makeAbsolute(entry.path), "r");
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (entry.kind == "dir") {
+            mReadDirs.insert(entry.path);
+        } else if (entry.kind == "clear") {
+            Hash::clearHash(entry.path);
+            mClearedHashes.push_back(entry.path);
+        } else {
+            mProbedFiles.insert(entry.path);
+        }
+    }
+
+    return true;
+}
+
+void Coordinator::cacheEnforcement(const FQName& package, Enforce enforcement,
+                                   size_t firstClearedHash) const {
+    if (mCacheDir.empty()) return;
+
+    const std::string key = getCacheKey();
+    if (key.empty()) return;
+
+    // These are inputs of every enforcement run so far, which is a superset
+    // of the inputs of this one. The cleared hashes are of this run only.
+    std::set<std::string> dirs;
+    std::set<std::string> files;
+    std::vector<std::string> clearedHashes;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        dirs = mReadDirs;
+        files = mReadFiles;
+        files.insert(mProbedFiles.begin(), mProbedFiles.end());
+        clearedHashes.assign(mClearedHashes.begin() + firstClearedHash, mClearedHashes.end());
+    }
+
+    Formatter out = Formatter::inMemory();
+    out << kEnforcementCacheHeader << "\n";
+    out << key << "\n";
+    for (const std::string& dir : dirs) {
+        out << "dir " << dirSignature(makeAbsolute(dir)) << " " << dir << "\n";
+    }
+    for (const std::string& path : files) {
+        out << "file " << fileSignature(makeAbsolute(path)) << " " << path << "\n";
+    }
+    for (const std::string& path : clearedHashes) {
+        out << "clear - " << path << "\n";
+    }
+
+    writeCacheFile(getEnforcementCachePath(package, enforcement), out.getOutput());
+}
+
 status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
                                                 Enforce enforcement) const {
     if(!currentPackage.hasVersion()) {
@@ -671,7 +1199,12 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
                                       &prevPackagePath);
         if (err != OK) return err;
 
-        if (existdir(makeAbsolute(prevPackagePath).c_str())) {
+        const std::string prevPath = makeAbsolute(prevPackagePath);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mReadDirs.insert(StringHelper::LTrim(prevPath, mRootPath));
+        }
+        if (existdir(prevPath.c_str())) {
             hasPrevPackage = true;
             break;
         }
@@ -703,6 +1236,7 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
     if (err != OK) {
         return err;
     }
+    prefetch(packageInterfaces);
 
     bool extendedInterface = false;
     for (const FQName &currentFQName : packageInterfaces) {
@@ -800,7 +1334,12 @@ Coordinator::HashStatus Coordinator::checkHash(const FQName& fqName) const {
     bool fileExists;
     std::vector<std::string> frozen =
         Hash::lookupHash(hashPath, fqName.string(), &error, &fileExists);
-    if (fileExists) onFileAccess(hashPath, "r");
+    if (fileExists) {
+        onFileAccess(hashPath, "r");
+    } else {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mProbedFiles.insert(StringHelper::LTrim(hashPath, mRootPath));
+    }
 
     if (error.size() > 0) {
         std::cerr << "ERROR: " << error << std::endl;
@@ -810,7 +1349,9 @@ Coordinator::HashStatus Coordinator::checkHash(const FQName& fqName) const {
     // hash not defined, interface not frozen
     if (frozen.size() == 0) {
         // This ensures that it can be detected.
+        std::lock_guard<std::mutex> lock(mMutex);
         Hash::clearHash(ast->getFilename());
+        mClearedHashes.push_back(ast->getFilename());
 
         return HashStatus::UNFROZEN;
     }
@@ -908,7 +1449,8 @@ bool Coordinator::MakeParentHierarchy(const std::string &path) {
             }
 
             int res = mkdir(partial.c_str(), kMode);
-            if (res < 0) {
+            // another thread may have just created it
+            if (res < 0 && !(errno == EEXIST && existdir(partial.c_str()))) {
                 return false;
             }
         } else if (!S_ISDIR(st.st_mode)) {
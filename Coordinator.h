@@ -22,18 +22,28 @@
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
 #include <utils/Errors.h>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace android {
 
 struct AST;
+struct ThreadPool;
 struct Type;
 
+// All methods are safe to call from multiple threads, except the setters and
+// addPackagePath, which must be called before anything is parsed.
 struct Coordinator {
-    Coordinator() {};
+    Coordinator();
+    ~Coordinator();
 
     const std::string& getRootPath() const;
     void setRootPath(const std::string &rootPath);
@@ -44,6 +54,24 @@ struct Coordinator {
 
     void setDepFile(const std::string& depFile);
 
+    // Output files are only replaced if their content changes, so that
+    // unchanged files keep their timestamps.
+    void setWriteOnlyIfChanged(bool writeOnlyIfChanged);
+
+    // Directory in which post-parsed ASTs and the results of
+    // enforceRestrictionsOnPackage are persisted across invocations. An AST
+    // is reused only if its file and every AST it was resolved against are
+    // unchanged, see ASTCache. A result is reused only if none of the files
+    // and package directories read while computing it have changed. Neither
+    // is reused by another hidl-gen build or with other package roots.
+    void setCacheDir(const std::string& cacheDir);
+
+    // Number of threads, including the calling thread, that may parse .hal
+    // files concurrently. With more than one, prefetch starts worker threads.
+    // Output is also generated on this many threads.
+    void setJobs(size_t jobs);
+    size_t getJobs() const;
+
     const std::string& getOwner() const;
     void setOwner(const std::string& owner);
 
@@ -95,6 +123,14 @@ struct Coordinator {
     status_t parseOptional(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs = nullptr,
                            Enforce enforcement = Enforce::FULL) const;
 
+    // Hint that fqNames are about to be parsed. They are parsed on worker
+    // threads (see setJobs), so that a later parse() of one of them only
+    // waits for it to finish. Restrictions are enforced once parse() asks for
+    // them, exactly as if the AST had been parsed then. Only pass files which
+    // are parsed anyway: prefetched parses print their errors and record
+    // their input files right away.
+    void prefetch(const std::vector<FQName>& fqNames) const;
+
     // Given package-root paths of ["hardware/interfaces",
     // "vendor/<something>/interfaces"], package roots of
     // ["android.hardware", "vendor.<something>.hardware"], and a
@@ -168,19 +204,55 @@ private:
     std::string mRootPath;    // root of android source tree (to locate package roots)
     std::string mOutputPath;  // root of output directory
     std::string mDepFile;     // location to write depfile
+    std::string mCacheDir;    // location of the persistent enforcement cache
 
     // hidl-gen options
     bool mVerbose = false;
+    bool mWriteOnlyIfChanged = false;
     std::string mOwner;
+    size_t mJobs = 1;
+
+    // guards everything mutable below, but not the ASTs themselves
+    mutable std::mutex mMutex;
+
+    struct CacheEntry {
+        AST* ast = nullptr;
+        bool done = false;            // false while owner is parsing it
+        std::thread::id owner;
+        bool prefetched = false;      // parsed by prefetch() and not requested by parse() yet
+        std::vector<FQName> imports;  // parsed while parsing this entry
+    };
 
-    // cache to parse().
-    mutable std::map<FQName, AST *> mCache;
+    // cache to parse(). A pending entry is used to find circular imports,
+    // and entries which failed to parse stay as nullptr.
+    mutable std::unordered_map<FQName, CacheEntry> mCache;
+    mutable std::condition_variable mCacheChanged;
+
+    // Every AST parsed successfully, including ones later rejected by
+    // enforcement. They, and the nodes in their arenas, are freed together
+    // with the Coordinator.
+    mutable std::vector<std::unique_ptr<AST>> mASTs;
+
+    // what each thread blocked in parseOptional is waiting for
+    mutable std::map<std::thread::id, FQName> mWaitingFor;
 
     // cache to enforceRestrictionsOnPackage().
-    mutable std::set<FQName> mPackagesEnforced;
+    mutable std::unordered_set<FQName> mPackagesEnforced;
 
     mutable std::set<std::string> mReadFiles;
 
+    // Package directories listed and files looked up (whether or not they
+    // exist). Together with mReadFiles, these are the recorded inputs of an
+    // enforcement cache entry.
+    mutable std::set<std::string> mReadDirs;
+    mutable std::set<std::string> mProbedFiles;
+
+    // Files whose hash was cleared by checkHash, in order.
+    mutable std::vector<std::string> mClearedHashes;
+
+    // Declared last, so that workers stop before anything they use is destroyed.
+    std::unique_ptr<ThreadPool> mPrefetchPool;
+
     // Returns the given path if it is absolute, otherwise it returns
     // the path relative to mRootPath
     std::string makeAbsolute(const std::string& string) const;
@@ -189,6 +261,31 @@ private:
     status_t enforceMinorVersionUprevs(const FQName& fqName, Enforce enforcement) const;
     status_t enforceHashes(const FQName &fqName) const;
 
+    // Helpers for parseOptional.
+    status_t parseUncached(const FQName& fqName, AST** ast) const;
+    status_t enforceParsed(const FQName& fqName, AST** ast, Enforce enforcement) const;
+    void finishCacheEntry(const FQName& fqName, AST* ast) const;
+    bool isWaitingOnThisThread(std::thread::id thread) const;
+    void claimPrefetched(const FQName& fqName) const;
+
+    // Identifies this hidl-gen build and where it finds each package root.
+    // Entries of the persistent caches are only reused with the same key.
+    // Empty, and the caches disabled, if the build cannot be identified.
+    std::string getCacheKey() const;
+    void writeCacheFile(const std::string& cachePath, const std::string& contents) const;
+
+    // Persistent cache of post-parsed ASTs, see setCacheDir. If loading
+    // fails, *ast is replaced by a new AST to parse into.
+    std::string getASTCachePath(const FQName& fqName) const;
+    bool loadCachedAST(const FQName& fqName, AST** ast, AST* typesAST) const;
+    void cacheAST(const FQName& fqName, AST* ast) const;
+
+    // Persistent cache of enforceRestrictionsOnPackage, see setCacheDir.
+    std::string getEnforcementCachePath(const FQName& package, Enforce enforcement) const;
+    bool isEnforcementCached(const FQName& package, Enforce enforcement) const;
+    void cacheEnforcement(const FQName& package, Enforce enforcement,
+                          size_t firstClearedHash) const;
+
     DISALLOW_COPY_AND_ASSIGN(Coordinator);
 };
 
@@ -33,6 +33,8 @@ struct DocComment {
 
    private:
     std::string mComment;
+
+    friend struct ASTCache;
 };
 
 struct DocCommentable {
@@ -45,6 +47,8 @@ struct DocCommentable {
 
    private:
     const DocComment* mDocComment = nullptr;
+
+    friend struct ASTCache;
 };
 
 }  // namespace android
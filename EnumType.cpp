@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <inttypes.h>
 #include <iostream>
+#include <set>
 #include <unordered_map>
 
 #include "Annotation.h"
@@ -152,6 +153,18 @@ bool EnumType::isEnum() const {
     return true;
 }
 
+std::string EnumType::getCppHashExpression(const std::string& name, size_t depth) const {
+    const ScalarType* scalarType = resolveToScalarType();
+    return scalarType->getCppHashExpression(
+            "static_cast<" + scalarType->getCppStackType() + ">(" + name + ")", depth);
+}
+
+void EnumType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                    size_t /* depth */) const {
+    // Marshalling does not validate enum values, any bit pattern will do.
+    out << name << " = static_cast<" << getCppStackType() << ">(_hidl_seed++);\n";
+}
+
 bool EnumType::deepCanCheckEquality(std::unordered_set<const Type*>* /* visited */) const {
     return true;
 }
@@ -400,9 +413,18 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     emitBitFieldBitwiseAssignmentOperator(out, "|");
     emitBitFieldBitwiseAssignmentOperator(out, "&");
 
+    emitBitFieldToString(out);
+    emitToString(out);
+    emitFromString(out);
+}
+
+void EnumType::emitBitFieldToString(Formatter& out) const {
     const ScalarType *scalarType = mStorageType->resolveToScalarType();
     CHECK(scalarType != NULL);
 
+    std::vector<const EnumValue*> values;
+    forEachValueFromRoot([&](EnumValue* value) { values.push_back(value); });
+
     out << "template<typename>\n"
         << "static inline std::string toString(" << resolveToScalarType()->getCppArgumentType()
         << " o);\n";
@@ -415,17 +437,28 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
             << "std::string os;\n"
             << getBitfieldCppType(StorageMode_Stack) << " flipped = 0;\n"
             << "bool first = true;\n";
-        forEachValueFromRoot([&](EnumValue* value) {
-            std::string valueName = fullName() + "::" + value->name();
-            out.sIf("(o & " + valueName + ")" +
-                    " == static_cast<" + scalarType->getCppStackType() +
-                    ">(" + valueName + ")", [&] {
-                out << "os += (first ? \"\" : \" | \");\n"
-                    << "os += \"" << value->name() << "\";\n"
-                    << "first = false;\n"
-                    << "flipped |= " << valueName << ";\n";
+        if (!values.empty()) {
+            out << "struct Flag { " << scalarType->getCppStackType()
+                << " mask; const char* name; };\n";
+            out << "static constexpr Flag kFlags[] = ";
+            out.block([&] {
+                for (const EnumValue* value : values) {
+                    out << "{static_cast<" << scalarType->getCppStackType() << ">("
+                        << fullName() << "::" << value->name() << "), \"" << value->name()
+                        << "\"},\n";
+                }
+            });
+            out << ";\n";
+            out << "for (const Flag& flag : kFlags) ";
+            out.block([&] {
+                out.sIf("(o & flag.mask) == flag.mask", [&] {
+                    out << "os += (first ? \"\" : \" | \");\n"
+                        << "os += flag.name;\n"
+                        << "first = false;\n"
+                        << "flipped |= flag.mask;\n";
+                }).endl();
             }).endl();
-        });
+        }
         // put remaining bits
         out.sIf("o != flipped", [&] {
             out << "os += (first ? \"\" : \" | \");\n";
@@ -437,16 +470,29 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
 
         out << "return os;\n";
     }).endl().endl();
+}
+
+void EnumType::emitToString(Formatter& out) const {
+    const ScalarType *scalarType = mStorageType->resolveToScalarType();
+    CHECK(scalarType != NULL);
 
     out << "static inline std::string toString(" << getCppArgumentType() << " o) ";
 
     out.block([&] {
         out << "using ::android::hardware::details::toHexString;\n";
-        forEachValueFromRoot([&](EnumValue* value) {
-            out.sIf("o == " + fullName() + "::" + value->name(), [&] {
-                out << "return \"" << value->name() << "\";\n";
-            }).endl();
-        });
+        // Aliases share a case label; the first name declared wins.
+        std::set<std::string> seenValues;
+        out << "switch (o) ";
+        out.block([&] {
+            forEachValueFromRoot([&](EnumValue* value) {
+                if (!seenValues.insert(value->value(scalarType->getKind())).second) {
+                    return;
+                }
+                out << "case " << fullName() << "::" << value->name() << ": return \""
+                    << value->name() << "\";\n";
+            });
+            out << "default: break;\n";
+        }).endl();
         out << "std::string os;\n";
         scalarType->emitHexDump(out, "os",
             "static_cast<" + scalarType->getCppStackType() + ">(o)");
@@ -454,6 +500,131 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     }).endl().endl();
 }
 
+// Seeded FNV-1a. Must match the hash emitted by emitFromString.
+static uint32_t enumNameHash(uint32_t seed, const std::string& name) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// Builds a hash-and-displace perfect hash over names: the bucket of a name is
+// enumNameHash(0, name) % displacements->size(), and its slot is
+// enumNameHash(displacement of its bucket, name) & (slots->size() - 1).
+static void buildEnumNamePerfectHash(const std::vector<std::string>& names,
+                                     std::vector<uint32_t>* displacements,
+                                     std::vector<ssize_t>* slots) {
+    size_t slotCount = 1;
+    while (slotCount < names.size()) slotCount <<= 1;
+
+    const size_t bucketCount = std::max(names.size() / 4, size_t(1));
+
+    std::vector<std::vector<size_t>> buckets(bucketCount);
+    for (size_t i = 0; i < names.size(); ++i) {
+        buckets[enumNameHash(0, names[i]) % bucketCount].push_back(i);
+    }
+
+    std::vector<size_t> order(bucketCount);
+    for (size_t i = 0; i < bucketCount; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    for (;;) {
+        displacements->assign(bucketCount, 0);
+        slots->assign(slotCount, -1);
+
+        bool placedAll = true;
+        for (size_t bucket : order) {
+            if (buckets[bucket].empty()) break;
+
+            bool placed = false;
+            for (uint32_t seed = 1; seed < (1u << 16) && !placed; ++seed) {
+                std::vector<size_t> taken;
+                for (size_t index : buckets[bucket]) {
+                    size_t slot = enumNameHash(seed, names[index]) & (slotCount - 1);
+                    if ((*slots)[slot] != -1 ||
+                        std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (taken.size() != buckets[bucket].size()) continue;
+
+                for (size_t i = 0; i < taken.size(); ++i) {
+                    (*slots)[taken[i]] = buckets[bucket][i];
+                }
+                (*displacements)[bucket] = seed;
+                placed = true;
+            }
+
+            if (!placed) {
+                placedAll = false;
+                break;
+            }
+        }
+
+        if (placedAll) return;
+
+        // Sparser tables always succeed eventually.
+        slotCount <<= 1;
+    }
+}
+
+void EnumType::emitFromString(Formatter& out) const {
+    std::vector<std::string> names;
+    forEachValueFromRoot([&](EnumValue* value) { names.push_back(value->name()); });
+
+    out << "static inline bool fromString(const std::string& name, " << getCppStackType()
+        << "* o) ";
+
+    out.block([&] {
+        if (names.empty()) {
+            out << "(void)name;\n"
+                << "(void)o;\n"
+                << "return false;\n";
+            return;
+        }
+
+        std::vector<uint32_t> displacements;
+        std::vector<ssize_t> slots;
+        buildEnumNamePerfectHash(names, &displacements, &slots);
+
+        out << "struct Entry { const char* name; " << getCppStackType() << " value; };\n";
+        out << "static constexpr uint32_t kDisplacements[] = {";
+        out.join(displacements.begin(), displacements.end(), ", ",
+                 [&](uint32_t displacement) { out << displacement << "u"; });
+        out << "};\n";
+        out << "static constexpr Entry kEntries[] = ";
+        out.block([&] {
+            for (ssize_t slot : slots) {
+                if (slot == -1) {
+                    out << "{nullptr, " << getCppStackType() << "{}},\n";
+                } else {
+                    out << "{\"" << names[slot] << "\", " << fullName() << "::" << names[slot]
+                        << "},\n";
+                }
+            }
+        });
+        out << ";\n";
+        out << "const auto hash = [&name](uint32_t seed) ";
+        out.block([&] {
+            out << "uint32_t h = 2166136261u ^ seed;\n";
+            out << "for (char c : name) h = (h ^ static_cast<uint8_t>(c)) * 16777619u;\n";
+            out << "return h;\n";
+        });
+        out << ";\n";
+        out << "const Entry& entry = kEntries[hash(kDisplacements[hash(0) % "
+            << displacements.size() << "]) & " << (slots.size() - 1) << "];\n";
+        out.sIf("entry.name == nullptr || name != entry.name", [&] {
+            out << "return false;\n";
+        }).endl();
+        out << "*o = entry.value;\n";
+        out << "return true;\n";
+    }).endl().endl();
+}
+
 void EnumType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const {
     const ScalarType *scalarType = mStorageType->resolveToScalarType();
     CHECK(scalarType != NULL);
@@ -879,6 +1050,15 @@ bool BitFieldType::isElidableType() const {
     return resolveToScalarType()->isElidableType();
 }
 
+std::string BitFieldType::getCppHashExpression(const std::string& name, size_t depth) const {
+    return resolveToScalarType()->getCppHashExpression(name, depth);
+}
+
+void BitFieldType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                        size_t depth) const {
+    resolveToScalarType()->emitCppBenchmarkFill(out, name, depth);
+}
+
 bool BitFieldType::deepCanCheckEquality(std::unordered_set<const Type*>* visited) const {
     return resolveToScalarType()->canCheckEquality(visited);
 }
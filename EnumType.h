@@ -47,6 +47,9 @@ struct EnumType : public Scope {
     std::string typeName() const override;
     bool isEnum() const override;
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     std::string getCppType(StorageMode mode,
                            bool specifyNamespaces) const override;
@@ -131,9 +134,15 @@ struct EnumType : public Scope {
             Formatter &out,
             const std::string &op) const;
 
+    void emitBitFieldToString(Formatter& out) const;
+    void emitToString(Formatter& out) const;
+    void emitFromString(Formatter& out) const;
+
     std::vector<EnumValue *> mValues;
     Reference<Type> mStorageType;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(EnumType);
 };
 
@@ -159,6 +168,8 @@ struct EnumValue : public LocalIdentifier, DocCommentable {
     const Location mLocation;
     bool mIsAutoFill;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(EnumValue);
 };
 
@@ -176,6 +187,9 @@ struct BitFieldType : public TemplatedType {
     bool isElidableType() const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     const ScalarType *resolveToScalarType() const override;
 
@@ -151,6 +151,14 @@ void FmqType::getAlignmentAndSize(
     *size = assertion.size();
 }
 
+void FmqType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    // The grantors and the handle.
+    cost->addBuffer(level, 0 /* size */);
+    cost->addBuffer(level, 0 /* size */);
+    ++cost->fdArrayObjects;
+    cost->variableSize = true;
+}
+
 bool FmqType::needsEmbeddedReadWrite() const {
     return true;
 }
@@ -59,6 +59,7 @@ struct FmqType : public TemplatedType {
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool resultNeedsDeref() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
 
@@ -68,6 +69,8 @@ struct FmqType : public TemplatedType {
     std::string mNamespace;
     std::string mName;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(FmqType);
 };
 
@@ -153,6 +153,25 @@ void HandleType::emitReaderWriterEmbedded(
     }
 }
 
+std::string HandleType::getCppEstimatedEmbeddedParcelSize(const std::string& /* name */,
+                                                          size_t /* depth */) const {
+    // The native_handle_t and its file descriptors.
+    return std::to_string(kParcelBufferObjectSize + kParcelFdArrayObjectSize);
+}
+
+void HandleType::addMarshalCost(MarshalCost* cost) const {
+    // writeNativeHandleNoDup writes the native_handle_t as a top-level
+    // buffer, there is no buffer for the hidl_handle itself.
+    addEmbeddedMarshalCost(cost, 0 /* level */);
+}
+
+void HandleType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    // The native_handle_t and its file descriptors.
+    cost->addBuffer(level, 0 /* size */);
+    ++cost->fdArrayObjects;
+    cost->variableSize = true;
+}
+
 bool HandleType::needsEmbeddedReadWrite() const {
     return true;
 }
@@ -57,6 +57,10 @@ struct HandleType : public Type {
             const std::string &offsetText) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                  size_t depth) const override;
+    void addMarshalCost(MarshalCost* cost) const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
 
     bool deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const override;
 
@@ -20,53 +20,67 @@
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 
 #include <android-base/logging.h>
+#include <hidl-util/SourceFile.h>
 #include <openssl/sha.h>
 
 namespace android {
 
 const std::vector<uint8_t> Hash::kEmptyHash = std::vector<uint8_t>(SHA256_DIGEST_LENGTH, 0);
 
-Hash& Hash::getMutableHash(const std::string& path) {
-    static std::map<std::string, Hash> hashes;
+static std::vector<uint8_t> sha256File(const SourceFile* file) {
+    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
+
+    // A file which cannot be read hashes like an empty one.
+    static const char kEmpty[] = "";
+    SHA256(reinterpret_cast<const uint8_t *>(file != nullptr ? file->data() : kEmpty),
+            file != nullptr ? file->size() : 0, ret.data());
 
-    auto it = hashes.find(path);
+    return ret;
+}
 
-    if (hashes.find(path) == hashes.end()) {
-        it = hashes.insert(it, {path, Hash(path)});
+Hash& Hash::getMutableHash(const std::string& path, const SourceFile* file) {
+    static std::mutex mutex;
+    static std::map<std::string, Hash> hashes;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = hashes.find(path);
+        if (it != hashes.end()) {
+            return it->second;
+        }
     }
 
-    return it->second;
+    // hash outside of the lock, another thread may have inserted it meanwhile
+    Hash hash(path, file != nullptr ? sha256File(file) : computeHash(path));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return hashes.insert({path, hash}).first->second;
 }
 
 const Hash& Hash::getHash(const std::string& path) {
-    return getMutableHash(path);
+    return getMutableHash(path, nullptr /* file */);
 }
 
-void Hash::clearHash(const std::string& path) {
-    getMutableHash(path).mHash = kEmptyHash;
+const Hash& Hash::getHash(const SourceFile& file) {
+    return getMutableHash(file.path(), &file);
 }
 
-static std::vector<uint8_t> sha256File(const std::string &path) {
-    std::ifstream stream(path);
-    std::stringstream fileStream;
-    fileStream << stream.rdbuf();
-    std::string fileContent = fileStream.str();
-
-    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
-
-    SHA256(reinterpret_cast<const uint8_t *>(fileContent.c_str()),
-            fileContent.size(), ret.data());
+void Hash::clearHash(const std::string& path) {
+    getMutableHash(path, nullptr /* file */).mHash = kEmptyHash;
+}
 
-    return ret;
+std::vector<uint8_t> Hash::computeHash(const std::string& path) {
+    return sha256File(SourceFile::open(path).get());
 }
 
-Hash::Hash(const std::string &path)
+Hash::Hash(const std::string& path, const std::vector<uint8_t>& hash)
   : mPath(path),
-    mHash(sha256File(path)) {}
+    mHash(hash) {}
 
 std::string Hash::hexString(const std::vector<uint8_t> &hash) {
     std::ostringstream s;
@@ -102,7 +116,10 @@ static const std::regex kHashLine(
 
 struct HashFile {
     static const HashFile *parse(const std::string &path, std::string *err) {
+        static std::mutex mutex;
         static std::map<std::string, HashFile*> hashfiles;
+        std::lock_guard<std::mutex> lock(mutex);
+
         auto it = hashfiles.find(path);
 
         if (it == hashfiles.end()) {
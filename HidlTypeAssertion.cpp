@@ -40,14 +40,16 @@ size_t HidlTypeAssertion::size() const {
 }
 
 void HidlTypeAssertion::EmitAll(Formatter &out) {
+    // Sorts a copy, since output may be generated on several threads.
+    Registry sorted = registry();
     std::sort(
-            registry().begin(),
-            registry().end(),
+            sorted.begin(),
+            sorted.end(),
             [](const auto &a, const auto &b) {
                 return a.first < b.first;
             });
 
-    for (auto entry : registry()) {
+    for (auto entry : sorted) {
         out << "static_assert(sizeof(::android::hardware::"
             << entry.first
             << ") == "
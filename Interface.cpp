@@ -271,6 +271,9 @@ bool Interface::fillDescriptorChainMethod(Method *method) const {
             });
             out << ");\n";
             out << "return ::android::hardware::Void();";
+        } },
+        { IMPL_PROXY, [method](auto &out) {
+            emitCachedProxyImpl(out, method);
         } } }, /* cppImpl */
         { { IMPL_INTERFACE, [this](auto &out) {
             std::vector<const Interface *> chain = typeChain();
@@ -285,6 +288,7 @@ bool Interface::fillDescriptorChainMethod(Method *method) const {
             out.unindent(); out.unindent();
         } } } /* javaImpl */
     );
+    method->setCachedByProxy();
     return true;
 }
 
@@ -307,6 +311,42 @@ void Interface::emitDigestChain(
     });
 }
 
+void Interface::emitCachedProxyImpl(Formatter& out, const Method* method) {
+    const std::string cached = "_hidl_mCached_" + method->name();
+    const std::string isCached = "_hidl_mIsCached_" + method->name();
+
+    // The flag is only set once the value is complete and is never cleared,
+    // so readers need no lock and _hidl_cb is not called with one held.
+    out.sIf("!" + isCached + ".load(std::memory_order_acquire)", [&] {
+        out << method->results()[0]->type().getCppStackType() << " _hidl_result;\n";
+        out << "::android::hardware::Return<void> _hidl_out = "
+            << gIBaseFqName.getInterfaceProxyFqName().cppName() << "::_hidl_" << method->name()
+            << "(this, this, [&](const auto &_hidl_value) {\n";
+        out.indent(2, [&] { out << "_hidl_result = _hidl_value;\n"; });
+        out << "});\n";
+        out.sIf("!_hidl_out.isOk()", [&] { out << "return _hidl_out;\n"; }).endl();
+        out << "std::unique_lock<std::mutex> _hidl_lock(_hidl_mMutex);\n";
+        out.sIf("!" + isCached + ".load(std::memory_order_relaxed)", [&] {
+            out << cached << " = std::move(_hidl_result);\n";
+            out << isCached << ".store(true, std::memory_order_release);\n";
+        }).endl();
+    }).endl();
+    out << "_hidl_cb(" << cached << ");\n";
+    out << "return ::android::hardware::Void();\n";
+}
+
+void Interface::emitProxyCacheMembers(Formatter& out) const {
+    for (const auto& tuple : allMethodsFromRoot()) {
+        const Method* method = tuple.method();
+        if (!method->isHidlReserved() || !method->isCachedByProxy()) {
+            continue;
+        }
+        out << "std::atomic<bool> _hidl_mIsCached_" << method->name() << "{false};\n";
+        out << method->results()[0]->type().getCppStackType() << " _hidl_mCached_"
+            << method->name() << ";\n";
+    }
+}
+
 bool Interface::fillHashChainMethod(Method *method) const {
     if (method->name() != "getHashChain") {
         return false;
@@ -325,6 +365,9 @@ bool Interface::fillHashChainMethod(Method *method) const {
             });
             out << ");\n";
             out << "return ::android::hardware::Void();\n";
+        } },
+        { IMPL_PROXY, [method](auto &out) {
+            emitCachedProxyImpl(out, method);
         } } }, /* cppImpl */
         { { IMPL_INTERFACE, [this, digestType, chainType](auto &out) {
             std::vector<const Interface *> chain = typeChain();
@@ -339,6 +382,7 @@ bool Interface::fillHashChainMethod(Method *method) const {
             out << "));\n";
         } } } /* javaImpl */
     );
+    method->setCachedByProxy();
     return true;
 }
 
@@ -354,6 +398,9 @@ bool Interface::fillGetDescriptorMethod(Method *method) const {
                 << fullName()
                 << "::descriptor);\n"
                 << "return ::android::hardware::Void();";
+        } },
+        { IMPL_PROXY, [method](auto &out) {
+            emitCachedProxyImpl(out, method);
         } } }, /* cppImpl */
         { { IMPL_INTERFACE, [this](auto &out) {
             out << "return "
@@ -361,6 +408,7 @@ bool Interface::fillGetDescriptorMethod(Method *method) const {
                 << ".kInterfaceName;\n";
         } } } /* javaImpl */
     );
+    method->setCachedByProxy();
     return true;
 }
 
@@ -440,11 +488,9 @@ bool Interface::fillDebugMethod(Method *method) const {
     return true;
 }
 
-static std::map<std::string, Method *> gAllReservedMethods;
-
 bool Interface::addMethod(Method *method) {
     if (isIBase()) {
-        if (!gAllReservedMethods.emplace(method->name(), method).second) {
+        if (!mDeclaredReservedMethods.emplace(method->name(), method).second) {
             std::cerr << "ERROR: hidl-gen encountered duplicated reserved method " << method->name()
                       << std::endl;
             return false;
@@ -599,11 +645,13 @@ status_t Interface::validateAnnotations() const {
     return OK;
 }
 
-bool Interface::addAllReservedMethods() {
+bool Interface::addAllReservedMethods(const Interface& iBase, Arena* arena) {
+    CHECK(iBase.isIBase());
+
     // use a sorted map to insert them in serial ID order.
     std::map<int32_t, Method *> reservedMethodsById;
-    for (const auto &pair : gAllReservedMethods) {
-        Method *method = pair.second->copySignature();
+    for (const auto &pair : iBase.mDeclaredReservedMethods) {
+        Method* method = pair.second->copySignature(arena);
         bool fillSuccess = fillPingMethod(method)
             || fillDescriptorChainMethod(method)
             || fillGetDescriptorMethod(method)
@@ -799,7 +847,7 @@ void Interface::emitReaderWriter(
         out << name
             << " = "
             << "::android::hardware::fromBinder<"
-            << fqName().cppName()
+            << fullName()
             << ","
             << getProxyFqName().cppName()
             << ","
@@ -822,7 +870,7 @@ void Interface::emitReaderWriter(
         out << "::android::sp<::android::hardware::IBinder> _hidl_binder = "
             << "::android::hardware::toBinder<\n";
         out.indent(2, [&] {
-            out << fqName().cppName()
+            out << fullName()
                 << ">("
                 << name
                 << ");\n";
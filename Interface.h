@@ -18,6 +18,8 @@
 
 #define INTERFACE_H_
 
+#include <map>
+#include <string>
 #include <vector>
 
 #include <hidl-hash/Hash.h>
@@ -27,6 +29,7 @@
 
 namespace android {
 
+struct Arena;
 struct Method;
 struct InterfaceAndMethod;
 
@@ -42,7 +45,9 @@ struct Interface : public Scope {
     const Hash* getFileHash() const;
 
     bool addMethod(Method *method);
-    bool addAllReservedMethods();
+    // Copies the methods declared by iBase into this interface, allocating
+    // the copies from arena. iBase may be this interface itself.
+    bool addAllReservedMethods(const Interface& iBase, Arena* arena);
 
     bool isElidableType() const override;
     bool isInterface() const override;
@@ -131,6 +136,9 @@ struct Interface : public Scope {
 
     bool hasOnewayMethods() const;
 
+    // Declares the proxy members backing methods that are isCachedByProxy.
+    void emitProxyCacheMembers(Formatter& out) const;
+
     bool deepIsJavaCompatible(std::unordered_set<const Type*>* visited) const override;
 
     bool isNeverStrongReference() const override;
@@ -141,6 +149,9 @@ struct Interface : public Scope {
     std::vector<Method*> mUserMethods;
     std::vector<Method*> mReservedMethods;
 
+    // Only for IBase: the methods as declared in IBase.hal, by name.
+    std::map<std::string, Method*> mDeclaredReservedMethods;
+
     const Hash* mFileHash;
 
     bool fillPingMethod(Method* method) const;
@@ -154,10 +165,15 @@ struct Interface : public Scope {
     bool fillGetDebugInfoMethod(Method* method) const;
     bool fillDebugMethod(Method* method) const;
 
+    // IMPL_PROXY of a method that is isCachedByProxy.
+    static void emitCachedProxyImpl(Formatter& out, const Method* method);
+
     void emitDigestChain(
         Formatter& out, const std::string& prefix, const std::vector<const Interface*>& chain,
         std::function<std::string(std::unique_ptr<ConstantExpression>)> byteToString) const;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(Interface);
 };
 
@@ -17,14 +17,66 @@
 #include "Location.h"
 
 #include <android-base/logging.h>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 namespace android {
 
-Position::Position(std::string filename, size_t line, size_t column)
-    : mFilename(filename), mLine(line), mColumn(column) {}
+static_assert(sizeof(Position) == 12, "Position should stay three small integers");
+
+namespace {
+
+// Every file name any Position has referred to. Names are never removed and
+// a deque never moves its elements, so references to them stay valid.
+struct FilenameTable {
+    std::mutex mutex;
+    std::deque<std::string> names{""};
+    std::unordered_map<std::string, uint32_t> ids{{"", 0}};
+};
+
+FilenameTable& filenameTable() {
+    // Leaked, positions may outlive static destruction.
+    static FilenameTable* table = new FilenameTable;
+    return *table;
+}
+
+}  // namespace
+
+uint32_t Position::internFilename(const std::string& filename) {
+    // Positions are created a file at a time, skip the table most of the time.
+    static thread_local std::string lastFilename;
+    static thread_local uint32_t lastId = 0;
+    if (filename == lastFilename) {
+        return lastId;
+    }
+
+    FilenameTable& table = filenameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.ids.find(filename);
+    if (it == table.ids.end()) {
+        CHECK(table.names.size() <= UINT32_MAX);
+        table.names.push_back(filename);
+        it = table.ids.insert({filename, table.names.size() - 1}).first;
+    }
+
+    lastFilename = filename;
+    lastId = it->second;
+    return lastId;
+}
+
+Position::Position(const std::string& filename, size_t line, size_t column)
+    : mFileId(internFilename(filename)), mLine(line), mColumn(column) {}
 
 const std::string& Position::filename() const {
-    return mFilename;
+    FilenameTable& table = filenameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names[mFileId];
+}
+
+uint32_t Position::fileId() const {
+    return mFileId;
 }
 
 size_t Position::line() const {
@@ -36,7 +88,7 @@ size_t Position::column() const {
 }
 
 bool Position::inSameFile(const Position& lhs, const Position& rhs) {
-    return lhs.mFilename == rhs.mFilename;
+    return lhs.mFileId == rhs.mFileId;
 }
 
 bool Position::operator<(const Position& pos) const {
@@ -100,7 +152,7 @@ std::ostream& operator<<(std::ostream& ostr, const Location& loc) {
     Position last = Position(loc.end().filename(), loc.end().line(),
                              std::max<size_t>(1u, loc.end().column() - 1));
     ostr << loc.begin();
-    if (loc.begin().filename() != last.filename()) {
+    if (!Position::inSameFile(loc.begin(), last)) {
         ostr << "-" << last;
     } else if (loc.begin().line() != last.line()) {
         ostr << "-" << last.line() << "." << last.column();
@@ -26,9 +26,11 @@ namespace android {
 
 struct Position {
     Position() = default;
-    Position(std::string filename, size_t line, size_t column);
+    Position(const std::string& filename, size_t line, size_t column);
 
+    // For diagnostics, file names are interned and only stored as an id.
     const std::string& filename() const;
+    uint32_t fileId() const;
 
     size_t line() const;
     size_t column() const;
@@ -39,12 +41,14 @@ struct Position {
     bool operator<(const Position& pos) const;
 
    private:
-    // File name to which this position refers.
-    std::string mFilename;
+    // Id of the file name to which this position refers, 0 is "".
+    uint32_t mFileId = 0;
     // Current line number.
-    size_t mLine;
+    uint32_t mLine = 0;
     // Current column number.
-    size_t mColumn;
+    uint32_t mColumn = 0;
+
+    static uint32_t internFilename(const std::string& filename);
 };
 
 std::ostream& operator<<(std::ostream& ostr, const Position& pos);
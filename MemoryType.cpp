@@ -133,6 +133,14 @@ void MemoryType::emitReaderWriterEmbedded(
             "::android::hardware");
 }
 
+void MemoryType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    // The handle and the name.
+    cost->addBuffer(level, 0 /* size */);
+    ++cost->fdArrayObjects;
+    cost->addBuffer(level, 0 /* size */);
+    cost->variableSize = true;
+}
+
 bool MemoryType::needsEmbeddedReadWrite() const {
     return true;
 }
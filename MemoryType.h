@@ -55,6 +55,7 @@ struct MemoryType : public Type {
             const std::string &offsetText) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool resultNeedsDeref() const override;
 
     bool isMemory() const override;
@@ -17,6 +17,7 @@
 #include "Method.h"
 
 #include "Annotation.h"
+#include "Arena.h"
 #include "ConstantExpression.h"
 #include "ScalarType.h"
 #include "Type.h"
@@ -53,6 +54,12 @@ void Method::fillImplementation(
             << "FATAL: mCppImpl IMPL_STUB will override IMPL_STUB_IMPL.";
 }
 
+void Method::setCachedByProxy() {
+    CHECK(mIsHidlReserved);
+    CHECK(mResults->size() == 1) << "FATAL: a cached method must have exactly one result.";
+    mIsCachedByProxy = true;
+}
+
 std::string Method::name() const {
     return mName;
 }
@@ -153,8 +160,8 @@ bool Method::overridesJavaImpl(MethodImplType type) const {
     return mJavaImpl.find(type) != mJavaImpl.end();
 }
 
-Method *Method::copySignature() const {
-    return new Method(mName.c_str(), mArgs, mResults, mOneway, mAnnotations, Location());
+Method* Method::copySignature(Arena* arena) const {
+    return arena->make<Method>(mName.c_str(), mArgs, mResults, mOneway, mAnnotations, Location());
 }
 
 void Method::setSerialId(size_t serial) {
@@ -35,6 +35,7 @@
 namespace android {
 
 struct Annotation;
+struct Arena;
 struct ConstantExpression;
 struct Formatter;
 struct ScalarType;
@@ -65,6 +66,9 @@ struct Method : DocCommentable {
     void cppImpl(MethodImplType type, Formatter &out) const;
     void javaImpl(MethodImplType type, Formatter &out) const;
     bool isHidlReserved() const { return mIsHidlReserved; }
+    // Reserved methods whose result is fixed for the lifetime of the remote
+    // object; proxies keep it after the first successful transaction.
+    bool isCachedByProxy() const { return mIsCachedByProxy; }
     bool isHiddenFromJava() const;
     const std::vector<Annotation *> &annotations() const;
 
@@ -79,7 +83,9 @@ struct Method : DocCommentable {
 
     // Make a copy with the same name, args, results, oneway, annotations.
     // Implementations, serial are not copied.
-    Method *copySignature() const;
+    // The copy shares the argument and result references of this method,
+    // so it must not outlive it.
+    Method* copySignature(Arena* arena) const;
 
     void setSerialId(size_t serial);
     size_t getSerialId() const;
@@ -91,6 +97,9 @@ struct Method : DocCommentable {
             MethodImpl cppImpl,
             MethodImpl javaImpl);
 
+    // Must be called after fillImplementation.
+    void setCachedByProxy();
+
     void generateCppReturnType(Formatter &out, bool specifyNamespaces = true) const;
     void generateCppSignature(Formatter &out,
                               const std::string &className = "",
@@ -124,6 +133,7 @@ struct Method : DocCommentable {
     // hard-coded implementation for HIDL reserved methods.
     MethodImpl mCppImpl;
     MethodImpl mJavaImpl;
+    bool mIsCachedByProxy = false;
 
     const Location mLocation;
 
@@ -34,8 +34,8 @@ std::string NamedType::localName() const {
     return mLocalName;
 }
 
-std::string NamedType::fullName() const {
-    return mFullName.cppName();
+const std::string& NamedType::fullName() const {
+    return mCppFullName.get([&] { return mFullName.cppName(); });
 }
 
 std::string NamedType::fullJavaName() const {
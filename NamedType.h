@@ -18,6 +18,7 @@
 
 #define NAMED_TYPE_H_
 
+#include "CachedString.h"
 #include "Location.h"
 #include "Type.h"
 
@@ -36,8 +37,8 @@ struct NamedType : public Type {
 
     std::string localName() const;
 
-    /* short for fqName().cppName() */
-    std::string fullName() const;
+    /* short for fqName().cppName(), computed once */
+    const std::string& fullName() const;
     /* short for fqName().fullJavaName() */
     std::string fullJavaName() const;
 
@@ -52,6 +53,7 @@ struct NamedType : public Type {
     const std::string mLocalName;
     const FQName mFullName;
     const Location mLocation;
+    CachedString mCppFullName;
 
     DISALLOW_COPY_AND_ASSIGN(NamedType);
 };
@@ -39,6 +39,15 @@ bool ScalarType::isElidableType() const {
     return true;
 }
 
+std::string ScalarType::getCppHashExpression(const std::string& name, size_t /* depth */) const {
+    return "std::hash<" + getCppStackType() + ">()(" + name + ")";
+}
+
+void ScalarType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                      size_t /* depth */) const {
+    out << name << " = static_cast<" << getCppStackType() << ">(_hidl_seed++);\n";
+}
+
 bool ScalarType::deepCanCheckEquality(std::unordered_set<const Type*>* /* visited */) const {
     return true;
 }
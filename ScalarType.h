@@ -45,6 +45,9 @@ struct ScalarType : public Type {
     const ScalarType *resolveToScalarType() const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     std::string typeName() const override;
     bool isValidEnumStorageType() const;
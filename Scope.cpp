@@ -22,7 +22,6 @@
 
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
-#include <hidl-util/StringHelper.h>
 #include <algorithm>
 #include <iostream>
 #include <vector>
@@ -56,7 +55,7 @@ NamedType *Scope::lookupType(const FQName &fqName) const {
         std::cerr << "ERROR: " << fqName.string() << " does not refer to a type." << std::endl;
         return nullptr;
     }
-    std::vector<std::string> names = fqName.names();
+    const std::vector<std::string>& names = fqName.names();
     CHECK_GT(names.size(), 0u);
     auto it = mTypeIndexByName.find(names[0]);
 
@@ -73,10 +72,8 @@ NamedType *Scope::lookupType(const FQName &fqName) const {
         return nullptr;
     }
     Scope *outerScope = static_cast<Scope *>(outerType);
-    // *slowly* pop first element
-    names.erase(names.begin());
     FQName innerName;
-    CHECK(FQName::parse(StringHelper::JoinStrings(names, "."), &innerName));
+    CHECK(FQName::parse(fqName.name().substr(names[0].size() + 1), &innerName));
     return outerScope->lookupType(innerName);
 }
 
@@ -171,6 +168,12 @@ void Scope::emitGlobalTypeDeclarations(Formatter& out) const {
     }
 }
 
+void Scope::emitGlobalTypeDefinitions(Formatter& out) const {
+    for (const Type* type : mTypes) {
+        type->emitGlobalTypeDefinitions(out);
+    }
+}
+
 void Scope::emitPackageTypeDeclarations(Formatter& out) const {
     for (const Type* type : mTypes) {
         type->emitPackageTypeDeclarations(out);
@@ -65,6 +65,7 @@ struct Scope : public NamedType {
 
     void emitTypeDeclarations(Formatter& out) const override;
     void emitGlobalTypeDeclarations(Formatter& out) const override;
+    void emitGlobalTypeDefinitions(Formatter& out) const override;
     void emitPackageTypeDeclarations(Formatter& out) const override;
     void emitPackageHwDeclarations(Formatter& out) const override;
 
@@ -88,6 +89,8 @@ struct Scope : public NamedType {
 
     bool mTypeOrderChanged = false;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(Scope);
 };
 
@@ -28,6 +28,21 @@ bool StringType::isString() const {
     return true;
 }
 
+std::string StringType::getCppHashExpression(const std::string& name, size_t depth) const {
+    // FNV-1a over the characters, without copying into a std::string.
+    const std::string hash = "_hidl_hash_" + std::to_string(depth);
+    const std::string index = "_hidl_index_" + std::to_string(depth);
+    return "[&] { size_t " + hash + " = 2166136261u; for (size_t " + index + " = 0; " + index +
+           " < " + name + ".size(); ++" + index + ") { " + hash + " = (" + hash +
+           " ^ static_cast<uint8_t>(" + name + ".c_str()[" + index + "])) * 16777619u; } return " +
+           hash + "; }()";
+}
+
+void StringType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                      size_t /* depth */) const {
+    out << name << " = std::string(_hidl_size, static_cast<char>('a' + _hidl_seed++ % 26));\n";
+}
+
 bool StringType::deepCanCheckEquality(std::unordered_set<const Type*>* /* visited */) const {
     return true;
 }
@@ -201,6 +216,18 @@ void StringType::emitJavaFieldReaderWriter(
         << ");\n";
 }
 
+std::string StringType::getCppEstimatedEmbeddedParcelSize(const std::string& /* name */,
+                                                          size_t /* depth */) const {
+    // The characters.
+    return std::to_string(kParcelBufferObjectSize);
+}
+
+void StringType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    // The characters.
+    cost->addBuffer(level, 0 /* size */);
+    cost->variableSize = true;
+}
+
 bool StringType::needsEmbeddedReadWrite() const {
     return true;
 }
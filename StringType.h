@@ -28,6 +28,9 @@ struct StringType : public Type {
     bool isString() const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     std::string typeName() const override;
 
@@ -75,6 +78,9 @@ struct StringType : public Type {
             bool isReader) const override;
 
     bool needsEmbeddedReadWrite() const override;
+    std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                  size_t depth) const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool resultNeedsDeref() const override;
 
     void emitVtsTypeDeclarations(Formatter& out) const override;
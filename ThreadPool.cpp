@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPool.h"
+
+#include <android-base/logging.h>
+
+namespace android {
+
+ThreadPool::ThreadPool(size_t threads) {
+    CHECK(threads > 0);
+
+    for (size_t i = 0; i < threads; i++) {
+        mThreads.emplace_back([this] { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.clear();
+        mStopping = true;
+    }
+    mTaskAvailable.notify_all();
+
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mTaskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return mTasks.empty() && mRunning == 0; });
+}
+
+size_t ThreadPool::size() const {
+    return mThreads.size();
+}
+
+void ThreadPool::run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mTaskAvailable.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+        if (mStopping) return;
+
+        std::function<void()> task = std::move(mTasks.front());
+        mTasks.pop_front();
+        mRunning++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        mRunning--;
+        if (mTasks.empty() && mRunning == 0) {
+            mIdle.notify_all();
+        }
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THREAD_POOL_H_
+
+#define THREAD_POOL_H_
+
+#include <android-base/macros.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+// Fixed number of worker threads running tasks in the order they are enqueued.
+struct ThreadPool {
+    explicit ThreadPool(size_t threads);
+
+    // Tasks which have not started yet are dropped. Running tasks are waited for.
+    ~ThreadPool();
+
+    void enqueue(std::function<void()> task);
+
+    // Blocks until every enqueued task has finished.
+    void wait();
+
+    size_t size() const;
+
+   private:
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mTaskAvailable;
+    std::condition_variable mIdle;
+    std::deque<std::function<void()>> mTasks;
+    size_t mRunning = 0;
+    bool mStopping = false;
+
+    void run();
+
+    DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace android
+
+#endif  // THREAD_POOL_H_
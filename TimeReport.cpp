@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TimeReport.h"
+
+#include <hidl-util/Formatter.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+namespace {
+
+struct Event {
+    const char* phase;
+    std::string detail;
+    int64_t startUs;
+    int64_t durationUs;
+    size_t thread;
+    // ru_maxrss: the peak RSS of the whole process so far, not of the phase.
+    long processPeakRssKbAtEnd;
+};
+
+struct Totals {
+    size_t count = 0;
+    int64_t durationUs = 0;
+    int64_t maxDurationUs = 0;
+    long processPeakRssKbAtEnd = 0;
+
+    void add(const Event& event) {
+        count++;
+        durationUs += event.durationUs;
+        maxDurationUs = std::max(maxDurationUs, event.durationUs);
+        processPeakRssKbAtEnd = std::max(processPeakRssKbAtEnd, event.processPeakRssKbAtEnd);
+    }
+};
+
+}  // namespace
+
+static std::atomic<bool> gEnabled(false);
+static std::chrono::steady_clock::time_point gStart;
+
+static std::mutex gMutex;
+static std::vector<Event> gEvents;                    // guarded by gMutex
+static std::map<std::thread::id, size_t> gThreadIds;  // guarded by gMutex
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 gStart)
+        .count();
+}
+
+static long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return usage.ru_maxrss;  // kilobytes on Linux
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+static std::string milliseconds(int64_t us) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", us / 1000.0);
+    return buffer;
+}
+
+void TimeReport::enable() {
+    gStart = std::chrono::steady_clock::now();
+    gEnabled = true;
+}
+
+bool TimeReport::isEnabled() {
+    return gEnabled;
+}
+
+TimeReport::Phase::Phase(const char* phase, const std::string& detail)
+    : mPhase(phase), mStartUs(0), mEnabled(isEnabled()) {
+    if (mEnabled) {
+        mDetail = detail;
+        mStartUs = nowUs();
+    }
+}
+
+TimeReport::Phase::~Phase() {
+    if (!mEnabled) {
+        return;
+    }
+
+    const int64_t endUs = nowUs();
+    const long rssKb = peakRssKb();
+
+    std::lock_guard<std::mutex> lock(gMutex);
+    const size_t thread =
+        gThreadIds.emplace(std::this_thread::get_id(), gThreadIds.size()).first->second;
+    gEvents.push_back({mPhase, std::move(mDetail), mStartUs, endUs - mStartUs, thread, rssKb});
+}
+
+static FILE* openReport(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "ERROR: Could not open %s for writing.\n", path.c_str());
+    }
+    return file;
+}
+
+status_t TimeReport::writeReport(const std::string& path) {
+    FILE* file = openReport(path);
+    if (file == nullptr) return UNKNOWN_ERROR;
+    Formatter out(file);
+
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    std::map<std::string, Totals> byPhase;
+    std::map<std::pair<std::string, std::string>, Totals> byDetail;
+    for (const Event& event : gEvents) {
+        byPhase[event.phase].add(event);
+        byDetail[{event.phase, event.detail}].add(event);
+    }
+
+    out << "{\n";
+    out.indent([&] {
+        out << "\"wallMs\": " << milliseconds(nowUs()) << ",\n";
+        out << "\"peakRssKb\": " << peakRssKb() << ",\n";
+
+        out << "\"phases\": [";
+        out.indent([&] {
+            bool first = true;
+            for (const auto& pair : byPhase) {
+                const Totals& totals = pair.second;
+                out << (first ? "\n" : ",\n");
+                out << "{\"phase\": " << jsonString(pair.first) << ", \"count\": " << totals.count
+                    << ", \"wallMs\": " << milliseconds(totals.durationUs)
+                    << ", \"maxMs\": " << milliseconds(totals.maxDurationUs)
+                    << ", \"processPeakRssKbAtEnd\": " << totals.processPeakRssKbAtEnd << "}";
+                first = false;
+            }
+        });
+        out << "\n],\n";
+
+        out << "\"details\": [";
+        out.indent([&] {
+            bool first = true;
+            for (const auto& pair : byDetail) {
+                const Totals& totals = pair.second;
+                out << (first ? "\n" : ",\n");
+                out << "{\"phase\": " << jsonString(pair.first.first)
+                    << ", \"detail\": " << jsonString(pair.first.second)
+                    << ", \"count\": " << totals.count
+                    << ", \"wallMs\": " << milliseconds(totals.durationUs)
+                    << ", \"processPeakRssKbAtEnd\": " << totals.processPeakRssKbAtEnd << "}";
+                first = false;
+            }
+        });
+        out << "\n]\n";
+    });
+    out << "}\n";
+
+    if (!out.close()) {
+        fprintf(stderr, "ERROR: could not write %s.\n", path.c_str());
+        return UNKNOWN_ERROR;
+    }
+    return OK;
+}
+
+status_t TimeReport::writeTrace(const std::string& path) {
+    FILE* file = openReport(path);
+    if (file == nullptr) return UNKNOWN_ERROR;
+    Formatter out(file);
+
+    std::lock_guard<std::mutex> lock(gMutex);
+
+    const pid_t pid = getpid();
+
+    out << "{\n";
+    out.indent([&] {
+        out << "\"displayTimeUnit\": \"ms\",\n";
+        out << "\"traceEvents\": [";
+        out.indent([&] {
+            bool first = true;
+            for (const Event& event : gEvents) {
+                out << (first ? "\n" : ",\n");
+                out << "{\"name\": " << jsonString(event.phase)
+                    << ", \"cat\": \"hidl-gen\", \"ph\": \"X\", \"ts\": " << event.startUs
+                    << ", \"dur\": " << event.durationUs << ", \"pid\": " << pid
+                    << ", \"tid\": " << event.thread
+                    << ", \"args\": {\"detail\": " << jsonString(event.detail)
+                    << ", \"processPeakRssKbAtEnd\": " << event.processPeakRssKbAtEnd << "}}";
+                first = false;
+            }
+        });
+        out << "\n]\n";
+    });
+    out << "}\n";
+
+    if (!out.close()) {
+        fprintf(stderr, "ERROR: could not write %s.\n", path.c_str());
+        return UNKNOWN_ERROR;
+    }
+    return OK;
+}
+
+}  // namespace android
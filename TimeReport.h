@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_REPORT_H_
+
+#define TIME_REPORT_H_
+
+#include <android-base/macros.h>
+#include <utils/Errors.h>
+#include <stdint.h>
+#include <string>
+
+namespace android {
+
+// Records the wall time of each phase of a hidl-gen run (parsing, postParse
+// passes, enforcement, generating each file), for --time-report and
+// --time-trace. Each phase also records the peak RSS of the whole process
+// when it ended, which is an upper bound of what the phase used. Nothing is recorded unless enable() was
+// called; until then a Phase costs one branch. Safe to use from any thread.
+struct TimeReport {
+    static void enable();
+    static bool isEnabled();
+
+    // Times its own lifetime as one occurrence of phase. detail names what
+    // the phase works on: an .hal file, a package or an output file.
+    // Phases nest, and the time of a phase includes the phases nested in it.
+    struct Phase {
+        Phase(const char* phase, const std::string& detail);
+        ~Phase();
+
+       private:
+        const char* mPhase;
+        std::string mDetail;
+        int64_t mStartUs;
+        bool mEnabled;
+
+        DISALLOW_COPY_AND_ASSIGN(Phase);
+    };
+
+    // Wall time, call count and process peak RSS at the end, per phase and
+    // per (phase, detail), as JSON.
+    static status_t writeReport(const std::string& path);
+
+    // Every recorded phase in Chrome trace event format, for chrome://tracing
+    // or Perfetto.
+    static status_t writeTrace(const std::string& path);
+};
+
+}  // namespace android
+
+#endif  // TIME_REPORT_H_
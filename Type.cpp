@@ -24,6 +24,7 @@
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 
 namespace android {
@@ -158,23 +159,28 @@ std::vector<const Reference<Type>*> Type::getStrongReferences() const {
     return ret;
 }
 
-status_t Type::recursivePass(const std::function<status_t(Type*)>& func,
-                             std::unordered_set<const Type*>* visited) {
+size_t Type::newVisitEpoch() {
+    // 0 is what every type starts with.
+    static std::atomic<size_t> nextEpoch(1);
+    return nextEpoch++;
+}
+
+status_t Type::recursivePass(const std::function<status_t(Type*)>& func, size_t epoch) {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (mVisitEpoch == epoch) return OK;
+    mVisitEpoch = epoch;
 
     status_t err = func(this);
     if (err != OK) return err;
 
     for (auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(func, visited);
+        err = nextType->recursivePass(func, epoch);
         if (err != OK) return err;
     }
 
     for (auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(func, visited);
+        err = nextRef->shallowGet()->recursivePass(func, epoch);
         if (err != OK) return err;
     }
 
@@ -182,22 +188,22 @@ status_t Type::recursivePass(const std::function<status_t(Type*)>& func,
 }
 
 status_t Type::recursivePass(const std::function<status_t(const Type*)>& func,
-                             std::unordered_set<const Type*>* visited) const {
+                             size_t epoch) const {
     if (mIsPostParseCompleted) return OK;
 
-    if (visited->find(this) != visited->end()) return OK;
-    visited->insert(this);
+    if (mVisitEpoch == epoch) return OK;
+    mVisitEpoch = epoch;
 
     status_t err = func(this);
     if (err != OK) return err;
 
     for (const auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(func, visited);
+        err = nextType->recursivePass(func, epoch);
         if (err != OK) return err;
     }
 
     for (const auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(func, visited);
+        err = nextRef->shallowGet()->recursivePass(func, epoch);
         if (err != OK) return err;
     }
 
@@ -354,6 +360,11 @@ bool Type::deepCanCheckEquality(std::unordered_set<const Type*>* /* visited */)
     return false;
 }
 
+std::string Type::getCppHashExpression(const std::string& /* name */, size_t /* depth */) const {
+    CHECK(!"Should not be here");
+    return std::string();
+}
+
 void Type::setPostParseCompleted() {
     CHECK(!mIsPostParseCompleted);
     mIsPostParseCompleted = true;
@@ -374,7 +385,7 @@ std::string Type::getCppType(StorageMode, bool) const {
 
 std::string Type::decorateCppName(
         const std::string &name, StorageMode mode, bool specifyNamespaces) const {
-    return getCppType(mode, specifyNamespaces) + " " + name;
+    return getCachedCppType(mode, specifyNamespaces) + " " + name;
 }
 
 std::string Type::getJavaType(bool /* forInitializer */) const {
@@ -457,6 +468,9 @@ void Type::emitDumpWithMethod(
         << ");\n";
 }
 
+void Type::emitCppBenchmarkFill(Formatter& /* out */, const std::string& /* name */,
+                                size_t /* depth */) const {}
+
 void Type::emitJavaDump(
         Formatter &out,
         const std::string &streamName,
@@ -619,6 +633,8 @@ void Type::emitTypeForwardDeclaration(Formatter&) const {}
 
 void Type::emitGlobalTypeDeclarations(Formatter&) const {}
 
+void Type::emitGlobalTypeDefinitions(Formatter&) const {}
+
 void Type::emitPackageTypeDeclarations(Formatter&) const {}
 
 void Type::emitPackageHwDeclarations(Formatter&) const {}
@@ -631,6 +647,74 @@ bool Type::needsEmbeddedReadWrite() const {
     return false;
 }
 
+std::string Type::getCppEstimatedParcelSize(const std::string& name) const {
+    const ScalarType* scalarType = resolveToScalarType();
+    if (scalarType != nullptr) {
+        size_t align, size;
+        scalarType->getAlignmentAndSize(&align, &size);
+        // Parcel pads every primitive to 4 bytes.
+        return std::to_string(std::max(size, size_t(4)));
+    }
+
+    if (isBinder()) {
+        return std::to_string(kParcelBinderObjectSize);
+    }
+
+    const std::string embedded = getCppEstimatedEmbeddedParcelSize(name, 0 /* depth */);
+    if (embedded == "0") {
+        return std::to_string(kParcelBufferObjectSize);
+    }
+    return std::to_string(kParcelBufferObjectSize) + " + " + embedded;
+}
+
+std::string Type::getCppEstimatedEmbeddedParcelSize(const std::string& /* name */,
+                                                    size_t /* depth */) const {
+    return "0";
+}
+
+void Type::MarshalCost::addBuffer(size_t level, size_t size) {
+    bytes += size;
+    ++bufferObjects;
+    depth = std::max(depth, level + 1);
+}
+
+void Type::MarshalCost::addRepeated(const MarshalCost& other, size_t count) {
+    bytes += other.bytes * count;
+    bufferObjects += other.bufferObjects * count;
+    fdArrayObjects += other.fdArrayObjects * count;
+    binderObjects += other.binderObjects * count;
+    depth = std::max(depth, other.depth);
+    variableSize = variableSize || other.variableSize;
+    recursive = recursive || other.recursive;
+}
+
+void Type::addMarshalCost(MarshalCost* cost) const {
+    const ScalarType* scalarType = resolveToScalarType();
+    if (scalarType != nullptr) {
+        size_t align, size;
+        scalarType->getAlignmentAndSize(&align, &size);
+        // Parcel pads every primitive to 4 bytes.
+        cost->bytes += std::max(size, size_t(4));
+        return;
+    }
+
+    if (isBinder()) {
+        ++cost->binderObjects;
+        return;
+    }
+
+    size_t align, size;
+    getAlignmentAndSize(&align, &size);
+    cost->addBuffer(0 /* level */, size);
+    addEmbeddedMarshalCost(cost, 1 /* level */);
+}
+
+void Type::addEmbeddedMarshalCost(MarshalCost* cost, size_t /* level */) const {
+    if (isBinder()) {
+        ++cost->binderObjects;
+    }
+}
+
 bool Type::resultNeedsDeref() const {
     return false;
 }
@@ -653,16 +737,23 @@ bool Type::deepNeedsResolveReferences(std::unordered_set<const Type*>* /* visite
     return false;
 }
 
-std::string Type::getCppStackType(bool specifyNamespaces) const {
-    return getCppType(StorageMode_Stack, specifyNamespaces);
+const std::string& Type::getCachedCppType(StorageMode mode, bool specifyNamespaces) const {
+    // Until then, references may still be resolved to other types.
+    CHECK(mIsPostParseCompleted) << typeName() << ": use getCppType until post parse completes";
+    return mCppTypes[2 * mode + specifyNamespaces].get(
+        [&] { return getCppType(mode, specifyNamespaces); });
+}
+
+const std::string& Type::getCppStackType(bool specifyNamespaces) const {
+    return getCachedCppType(StorageMode_Stack, specifyNamespaces);
 }
 
-std::string Type::getCppResultType(bool specifyNamespaces) const {
-    return getCppType(StorageMode_Result, specifyNamespaces);
+const std::string& Type::getCppResultType(bool specifyNamespaces) const {
+    return getCachedCppType(StorageMode_Result, specifyNamespaces);
 }
 
-std::string Type::getCppArgumentType(bool specifyNamespaces) const {
-    return getCppType(StorageMode_Argument, specifyNamespaces);
+const std::string& Type::getCppArgumentType(bool specifyNamespaces) const {
+    return getCachedCppType(StorageMode_Argument, specifyNamespaces);
 }
 
 void Type::emitJavaReaderWriterWithSuffix(
@@ -20,12 +20,14 @@
 
 #include <android-base/macros.h>
 #include <utils/Errors.h>
+#include <array>
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "CachedString.h"
 #include "DocComment.h"
 #include "Reference.h"
 
@@ -80,11 +82,13 @@ struct Type : DocCommentable {
     virtual std::vector<const Reference<Type>*> getStrongReferences() const;
 
     // Proceeds recursive pass
-    // Makes sure to visit each node only once.
-    status_t recursivePass(const std::function<status_t(Type*)>& func,
-                           std::unordered_set<const Type*>* visited);
+    // Makes sure to visit each node only once per epoch, see newVisitEpoch.
+    status_t recursivePass(const std::function<status_t(Type*)>& func, size_t epoch);
     status_t recursivePass(const std::function<status_t(const Type*)>& func,
-                           std::unordered_set<const Type*>* visited) const;
+                           size_t epoch) const;
+
+    // Returns an epoch no recursivePass has been called with yet.
+    static size_t newVisitEpoch();
 
     // Recursive tree pass that completes type declarations
     // that depend on super types
@@ -128,6 +132,10 @@ struct Type : DocCommentable {
     bool canCheckEquality(std::unordered_set<const Type*>* visited) const;
     virtual bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const;
 
+    // Returns a C++ expression of type size_t hashing the value "name".
+    // Only types that canCheckEquality support this.
+    virtual std::string getCppHashExpression(const std::string& name, size_t depth) const;
+
     // Marks that package proceeding is completed
     // Post parse passes must be proceeded during owner package parsing
     void setPostParseCompleted();
@@ -151,11 +159,13 @@ struct Type : DocCommentable {
             StorageMode mode,
             bool specifyNamespaces) const;
 
-    std::string getCppStackType(bool specifyNamespaces = true) const;
+    // getCppType for each storage mode, memoized: only valid once post parse
+    // is completed, e.g. for code generation. Use getCppType before.
+    const std::string& getCppStackType(bool specifyNamespaces = true) const;
 
-    std::string getCppResultType(bool specifyNamespaces = true) const;
+    const std::string& getCppResultType(bool specifyNamespaces = true) const;
 
-    std::string getCppArgumentType(bool specifyNamespaces = true) const;
+    const std::string& getCppArgumentType(bool specifyNamespaces = true) const;
 
     // For an array type, dimensionality information will be accumulated at the
     // end of the returned string.
@@ -228,6 +238,13 @@ struct Type : DocCommentable {
             const std::string &streamName,
             const std::string &name) const;
 
+    // Fills the value "name" with deterministic synthetic data for
+    // -Lc++-bench. The emitted code reads "size_t _hidl_size" for the length
+    // of strings and vectors and increments "uint32_t _hidl_seed" for each
+    // scalar. Types that cannot be synthesized are left default-initialized.
+    virtual void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                      size_t depth) const;
+
     virtual bool useParentInEmitResolveReferencesEmbedded() const;
 
     virtual bool useNameInEmitReaderWriterEmbedded(bool isReader) const;
@@ -255,6 +272,10 @@ struct Type : DocCommentable {
 
     virtual void emitGlobalTypeDeclarations(Formatter& out) const;
 
+    // Emit inline definitions for emitGlobalTypeDeclarations, after the
+    // global declarations of every type in the file.
+    virtual void emitGlobalTypeDefinitions(Formatter& out) const;
+
     // Emit scope C++ forward declaration.
     // There is no need to forward declare interfaces, as
     // they are always declared in global scope in dedicated file.
@@ -276,9 +297,54 @@ struct Type : DocCommentable {
 
     virtual void emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const;
 
+    // Sizes of the kernel objects a Parcel records for a scatter-gather
+    // buffer, a file descriptor array and a binder reference on LP64.
+    static constexpr size_t kParcelBufferObjectSize = 40;
+    static constexpr size_t kParcelFdArrayObjectSize = 32;
+    static constexpr size_t kParcelBinderObjectSize = 24;
+
     virtual bool needsEmbeddedReadWrite() const;
     virtual bool resultNeedsDeref() const;
 
+    // Returns a C++ expression estimating how many bytes writing the value
+    // "name" as a method argument adds to a Parcel. Used to pre-size Parcels.
+    virtual std::string getCppEstimatedParcelSize(const std::string& name) const;
+
+    // Same as above, but only for the buffers embedded in "name", i.e. what
+    // emitReaderWriterEmbedded writes. Returns "0" if there are none.
+    virtual std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                          size_t depth) const;
+
+    // Static estimate of what marshalling one value costs, see -Lmarshal-cost.
+    // Strings, vectors, handles etc. are data dependent: their variable part
+    // is not counted in bytes and each vector element is counted once.
+    struct MarshalCost {
+        // Fixed bytes copied: primitives in the Parcel plus buffer contents.
+        size_t bytes = 0;
+        // writeBuffer/writeEmbeddedBuffer calls.
+        size_t bufferObjects = 0;
+        size_t fdArrayObjects = 0;
+        size_t binderObjects = 0;
+        // Longest chain of buffers embedded in one another.
+        size_t depth = 0;
+        bool variableSize = false;
+        // A recursive struct was cut short, the real cost is unbounded.
+        bool recursive = false;
+
+        void addBuffer(size_t level, size_t size);
+        void addRepeated(const MarshalCost& other, size_t count);
+
+        std::unordered_set<const Type*> inProgress;
+    };
+
+    // Adds the cost of writing this type as a method argument or result,
+    // i.e. what emitReaderWriter writes.
+    virtual void addMarshalCost(MarshalCost* cost) const;
+
+    // Same as above, but only for what is embedded in a value living in a
+    // buffer "level" levels deep, i.e. what emitReaderWriterEmbedded writes.
+    virtual void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const;
+
     bool needsResolveReferences() const;
     bool needsResolveReferences(std::unordered_set<const Type*>* visited) const;
     virtual bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const;
@@ -344,6 +410,18 @@ struct Type : DocCommentable {
     bool mIsPostParseCompleted = false;
     Scope* const mParent;
 
+    // Epoch of the last recursivePass which visited this type. Passes skip
+    // types whose post parse is completed, so only the AST being processed,
+    // which is owned by a single thread, writes it.
+    mutable size_t mVisitEpoch = 0;
+
+    // getCppType results, indexed by storage mode and specifyNamespaces.
+    std::array<CachedString, 6> mCppTypes;
+
+    // getCppType, memoized once post parse is completed: code generation asks
+    // for the same names over and over, and the type cannot change anymore.
+    const std::string& getCachedCppType(StorageMode mode, bool specifyNamespaces) const;
+
     DISALLOW_COPY_AND_ASSIGN(Type);
 };
 
@@ -371,6 +449,8 @@ struct TemplatedType : public Type {
     Reference<Type> mElementType;
 
    private:
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(TemplatedType);
 };
 
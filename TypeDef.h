@@ -48,6 +48,8 @@ struct TypeDef : public NamedType {
    private:
     Reference<Type> mReferencedType;
 
+    friend struct ASTCache;
+
     DISALLOW_COPY_AND_ASSIGN(TypeDef);
 };
 
@@ -75,6 +75,34 @@ bool VectorType::isVectorOfBinders() const {
     return mElementType->isBinder();
 }
 
+std::string VectorType::getCppHashExpression(const std::string& name, size_t depth) const {
+    const std::string hash = "_hidl_hash_" + std::to_string(depth);
+    const std::string element = "_hidl_element_" + std::to_string(depth);
+    return "[&] { size_t " + hash + " = " + name + ".size(); for (const auto &" + element +
+           " : " + name + ") { " + hash + " = " + hash + " * 31 + " +
+           mElementType->getCppHashExpression(element, depth + 1) + "; } return " + hash +
+           "; }()";
+}
+
+void VectorType::emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                                      size_t depth) const {
+    // Recursive structs nest through vectors; keep nested ones small and
+    // stop eventually.
+    if (depth > 4) {
+        return;
+    }
+
+    const std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    out << name << ".resize("
+        << (depth == 0 ? "_hidl_size" : "std::min<size_t>(_hidl_size, 4)") << ");\n";
+    out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < " << name
+        << ".size(); ++" << iteratorName << ") ";
+    out.block([&] {
+        mElementType->emitCppBenchmarkFill(out, name + "[" + iteratorName + "]", depth + 1);
+    }).endl();
+}
+
 bool VectorType::deepCanCheckEquality(std::unordered_set<const Type*>* visited) const {
     return mElementType->canCheckEquality(visited);
 }
@@ -109,7 +137,20 @@ std::string VectorType::getCppType(StorageMode mode,
     }
 }
 
+static bool gJavaPrimitiveVectors = false;
+
+void VectorType::setJavaPrimitiveVectors(bool enabled) {
+    gJavaPrimitiveVectors = enabled;
+}
+
+bool VectorType::isJavaPrimitiveVector() const {
+    return gJavaPrimitiveVectors && mElementType->resolveToScalarType() != nullptr;
+}
+
 std::string VectorType::getJavaType(bool /* forInitializer */) const {
+    if (isJavaPrimitiveVector()) {
+        return mElementType->getJavaType() + "[]";
+    }
 
     std::string elementJavaType;
     if (mElementType->isArray()) {
@@ -313,6 +354,14 @@ void VectorType::emitReaderWriterEmbedded(
             "::android::hardware");
 
     if (!mElementType->needsEmbeddedReadWrite()) {
+        // The element buffer written above is the whole transfer; make sure
+        // the elements really are plain bytes.
+        if ((mElementType->isCompoundType() || mElementType->isArray()) &&
+            !mElementType->containsPointer()) {
+            const std::string elementType = mElementType->getCppStackType();
+            out << "static_assert(std::is_trivially_copyable<" << elementType
+                << ">::value, \"" << elementType << " is transferred as raw bytes\");\n\n";
+        }
         return;
     }
 
@@ -469,6 +518,36 @@ void VectorType::emitJavaReaderWriter(
         const std::string &parcelObj,
         const std::string &argName,
         bool isReader) const {
+    if (isJavaPrimitiveVector()) {
+        size_t align, size;
+        getAlignmentAndSize(&align, &size);
+        if (isReader) {
+            out << "null;\n";
+        }
+
+        out << "{\n";
+        out.indent();
+
+        out << "android.os.HwBlob _hidl_blob = ";
+        if (isReader) {
+            out << parcelObj << ".readBuffer(" << size << " /* size */);\n";
+        } else {
+            out << "new android.os.HwBlob(" << size << " /* size */);\n";
+        }
+
+        emitJavaPrimitiveFieldReaderWriter(out, parcelObj, "_hidl_blob", argName,
+                                           "0 /* offset */", isReader);
+
+        if (!isReader) {
+            out << parcelObj << ".writeBuffer(_hidl_blob);\n";
+        }
+
+        out.unindent();
+        out << "}\n";
+
+        return;
+    }
+
     if (mElementType->isCompoundType()) {
 
         if (isReader) {
@@ -546,6 +625,13 @@ void VectorType::emitJavaFieldInitializer(
         Formatter &out, const std::string &fieldName) const {
     std::string javaType = getJavaType(false /* forInitializer */);
 
+    if (isJavaPrimitiveVector()) {
+        // Not final: readers replace the array once the size is known.
+        out << javaType << " " << fieldName << " = new " << mElementType->getJavaType()
+            << "[0];\n";
+        return;
+    }
+
     out << "final "
         << javaType
         << " "
@@ -563,6 +649,11 @@ void VectorType::emitJavaFieldReaderWriter(
         const std::string &fieldName,
         const std::string &offset,
         bool isReader) const {
+    if (isJavaPrimitiveVector()) {
+        emitJavaPrimitiveFieldReaderWriter(out, parcelName, blobName, fieldName, offset, isReader);
+        return;
+    }
+
     VectorType::EmitJavaFieldReaderWriterForElementType(
             out,
             depth,
@@ -574,6 +665,62 @@ void VectorType::emitJavaFieldReaderWriter(
             isReader);
 }
 
+void VectorType::emitJavaDump(
+        Formatter &out,
+        const std::string &streamName,
+        const std::string &name) const {
+    if (isJavaPrimitiveVector()) {
+        out << streamName << ".append(java.util.Arrays.toString(" << name << "));\n";
+        return;
+    }
+    Type::emitJavaDump(out, streamName, name);
+}
+
+void VectorType::emitJavaPrimitiveFieldReaderWriter(
+        Formatter &out,
+        const std::string &parcelName,
+        const std::string &blobName,
+        const std::string &fieldName,
+        const std::string &offset,
+        bool isReader) const {
+    size_t elementAlign, elementSize;
+    mElementType->getAlignmentAndSize(&elementAlign, &elementSize);
+
+    const std::string suffix = mElementType->getJavaSuffix();
+
+    // One bulk copy between the element buffer and the array, no boxing.
+    out << "{\n";
+    out.indent();
+
+    if (isReader) {
+        out << "int _hidl_vec_size = " << blobName << ".getInt32(" << offset
+            << " + 8 /* offsetof(hidl_vec<T>, mSize) */);\n";
+        out << "android.os.HwBlob childBlob = " << parcelName << ".readEmbeddedBuffer(\n";
+        out.indent(2, [&] {
+            out << "_hidl_vec_size * " << elementSize << "," << blobName << ".handle(),\n"
+                << offset << " + 0 /* offsetof(hidl_vec<T>, mBuffer) */,"
+                << "true /* nullable */);\n\n";
+        });
+        out << fieldName << " = new " << mElementType->getJavaType() << "[_hidl_vec_size];\n";
+        out << "childBlob.copyTo" << suffix << "Array(0, " << fieldName
+            << ", _hidl_vec_size);\n";
+    } else {
+        out << "int _hidl_vec_size = " << fieldName << ".length;\n";
+        out << blobName << ".putInt32(" << offset
+            << " + 8 /* offsetof(hidl_vec<T>, mSize) */, _hidl_vec_size);\n";
+        out << blobName << ".putBool(" << offset
+            << " + 12 /* offsetof(hidl_vec<T>, mOwnsBuffer) */, false);\n";
+        out << "android.os.HwBlob childBlob = new android.os.HwBlob((int)(_hidl_vec_size * "
+            << elementSize << "));\n";
+        out << "childBlob.put" << suffix << "Array(0, " << fieldName << ");\n";
+        out << blobName << ".putBlob(" << offset
+            << " + 0 /* offsetof(hidl_vec<T>, mBuffer) */, childBlob);\n";
+    }
+
+    out.unindent();
+    out << "}\n";
+}
+
 void VectorType::EmitJavaFieldReaderWriterForElementType(
         Formatter &out,
         size_t depth,
@@ -709,6 +856,44 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
     out << "}\n";
 }
 
+std::string VectorType::getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                          size_t depth) const {
+    // The element buffer.
+    const std::string dataSize = std::to_string(kParcelBufferObjectSize);
+
+    if (!mElementType->needsEmbeddedReadWrite()) {
+        return dataSize;
+    }
+
+    const std::string elementName = "_hidl_element_" + std::to_string(depth);
+
+    return "[&] { size_t _hidl_size = " + dataSize + "; for (const auto &" + elementName +
+           " : " + name + ") { _hidl_size += " +
+           mElementType->getCppEstimatedEmbeddedParcelSize(elementName, depth + 1) +
+           "; } return _hidl_size; }()";
+}
+
+void VectorType::addMarshalCost(MarshalCost* cost) const {
+    if (!isVectorOfBinders()) {
+        Type::addMarshalCost(cost);
+        return;
+    }
+
+    // The element count, then each binder on its own, without buffers, see
+    // emitReaderWriterForVectorOfBinders. Elements are counted once.
+    cost->bytes += sizeof(uint64_t);
+    cost->variableSize = true;
+    mElementType->addMarshalCost(cost);
+}
+
+void VectorType::addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const {
+    // The element buffer, its elements are counted once.
+    cost->addBuffer(level, 0 /* size */);
+    cost->variableSize = true;
+
+    mElementType->addEmbeddedMarshalCost(cost, level + 1);
+}
+
 bool VectorType::needsEmbeddedReadWrite() const {
     return true;
 }
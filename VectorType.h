@@ -31,12 +31,20 @@ struct VectorType : public TemplatedType {
     bool isVector() const override;
     bool isVectorOfBinders() const;
 
+    // Opt-in: represent vec<scalar> as a Java primitive array (int[], ...)
+    // instead of a boxed java.util.ArrayList. Changes the generated Java API.
+    static void setJavaPrimitiveVectors(bool enabled);
+    bool isJavaPrimitiveVector() const;
+
     std::string templatedTypeName() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
 
     std::vector<const Reference<Type>*> getStrongReferences() const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
+    std::string getCppHashExpression(const std::string& name, size_t depth) const override;
+    void emitCppBenchmarkFill(Formatter& out, const std::string& name,
+                              size_t depth) const override;
 
     std::string getCppType(
             StorageMode mode,
@@ -101,6 +109,11 @@ struct VectorType : public TemplatedType {
     void emitJavaFieldInitializer(
             Formatter &out, const std::string &fieldName) const override;
 
+    void emitJavaDump(
+            Formatter &out,
+            const std::string &streamName,
+            const std::string &name) const override;
+
     void emitJavaFieldReaderWriter(
             Formatter &out,
             size_t depth,
@@ -110,6 +123,14 @@ struct VectorType : public TemplatedType {
             const std::string &offset,
             bool isReader) const override;
 
+    void emitJavaPrimitiveFieldReaderWriter(
+            Formatter &out,
+            const std::string &parcelName,
+            const std::string &blobName,
+            const std::string &fieldName,
+            const std::string &offset,
+            bool isReader) const;
+
     static void EmitJavaFieldReaderWriterForElementType(
             Formatter &out,
             size_t depth,
@@ -121,6 +142,10 @@ struct VectorType : public TemplatedType {
             bool isReader);
 
     bool needsEmbeddedReadWrite() const override;
+    std::string getCppEstimatedEmbeddedParcelSize(const std::string& name,
+                                                  size_t depth) const override;
+    void addMarshalCost(MarshalCost* cost) const override;
+    void addEmbeddedMarshalCost(MarshalCost* cost, size_t level) const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
 
@@ -238,6 +238,9 @@ void AST::generateInterfaceHeader(Formatter& out) const {
     out << "#include <utils/NativeHandle.h>\n";
     out << "#include <utils/misc.h>\n\n"; /* for report_sysprop_change() */
 
+    out << "#include <cstring>\n";
+    out << "#include <functional>\n\n";
+
     enterLeaveNamespace(out, true /* enter */);
     out << "\n";
 
@@ -344,6 +347,7 @@ void AST::generateInterfaceHeader(Formatter& out) const {
     enterLeaveNamespace(out, false /* enter */);
 
     mRootScope.emitGlobalTypeDeclarations(out);
+    mRootScope.emitGlobalTypeDefinitions(out);
 
     out << "\n#endif  // " << guard << "\n";
 }
@@ -461,7 +465,7 @@ void AST::generatePassthroughMethod(Formatter& out, const Method* method) const
     if (method->isOneway()) {
         out << "addOnewayTask([mImpl = this->mImpl\n"
             << "#ifdef __ANDROID_DEBUGGABLE__\n"
-               ", mEnableInstrumentation = this->mEnableInstrumentation, "
+               ", _hidl_instrumented, "
                "mInstrumentationCallbacks = this->mInstrumentationCallbacks\n"
             << "#endif // __ANDROID_DEBUGGABLE__\n";
         for (const auto &arg : method->args()) {
@@ -639,7 +643,7 @@ void AST::generateStubHeader(Formatter& out) const {
 
     generateMethods(out,
                     [&](const Method* method, const Interface*) {
-                        if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY)) {
+                        if (method->isHidlReserved() && method->overridesCppImpl(IMPL_STUB)) {
                             return;
                         }
 
@@ -670,7 +674,7 @@ void AST::generateStubHeader(Formatter& out) const {
 
         if (elidedReturn == nullptr && returnsValue) {
             out << "using " << method->name() << "_cb = "
-                << iface->fqName().cppName()
+                << iface->fullName()
                 << "::" << method->name() << "_cb;\n";
         }
         method->generateCppSignature(out);
@@ -700,6 +704,7 @@ void AST::generateProxyHeader(Formatter& out) const {
     out << "#define " << guard << "\n\n";
 
     out << "#include <hidl/HidlTransportSupport.h>\n\n";
+    out << "#include <atomic>\n\n";
 
     std::vector<std::string> packageComponents;
     getPackageAndVersionComponents(
@@ -732,7 +737,8 @@ void AST::generateProxyHeader(Formatter& out) const {
     generateMethods(
         out,
         [&](const Method* method, const Interface*) {
-            if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY)) {
+            if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY) &&
+                !method->isCachedByProxy()) {
                 return;
             }
 
@@ -761,6 +767,7 @@ void AST::generateProxyHeader(Formatter& out) const {
     out << "std::mutex _hidl_mMutex;\n"
         << "std::vector<::android::sp<::android::hardware::hidl_binder_death_recipient>>"
         << " _hidl_mDeathRecipients;\n";
+    iface->emitProxyCacheMembers(out);
     out.unindent();
     out << "};\n\n";
 
@@ -999,7 +1006,9 @@ void AST::generateProxyMethodSource(Formatter& out, const std::string& klassName
 
 void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& klassName,
                                           const Method* method) const {
-    if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY)) {
+    // Cached methods still need the transaction for their first call.
+    if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY) &&
+        !method->isCachedByProxy()) {
         return;
     }
 
@@ -1047,6 +1056,17 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
     declareCppReaderLocals(
             out, method->results(), true /* forResults */);
 
+    if (!method->args().empty()) {
+        // Grow the request Parcel once instead of on every write.
+        const std::string descriptor = getInterface()->fqName().string();
+        out << "_hidl_data.setDataCapacity("
+            << ((descriptor.size() + 1 + 3) & ~size_t(3)) << " /* interface token */";
+        for (const auto& arg : method->args()) {
+            out << " + " << arg->type().getCppEstimatedParcelSize(arg->name());
+        }
+        out << ");\n\n";
+    }
+
     out << "_hidl_err = _hidl_data.writeInterfaceToken(";
     out << klassName;
     out << "::descriptor);\n";
@@ -1305,6 +1325,28 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
     out.unindent();
 
     out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+
+    if (iface->isIBase()) {
+        generateStubSwitch(out, iface);
+    } else {
+        generateStubTransactionTable(out, iface);
+    }
+
+    out.sIf("_hidl_err == ::android::UNEXPECTED_NULL", [&] {
+        out << "_hidl_err = ::android::hardware::writeToParcel(\n";
+        out.indent(2, [&] {
+            out << "::android::hardware::Status::fromExceptionCode(::android::hardware::Status::EX_NULL_POINTER),\n";
+            out << "_hidl_reply);\n";
+        });
+    });
+
+    out << "return _hidl_err;\n";
+
+    out.unindent();
+    out << "}\n\n";
+}
+
+void AST::generateStubSwitch(Formatter& out, const Interface* iface) const {
     out << "switch (_hidl_code) {\n";
     out.indent();
 
@@ -1312,9 +1354,6 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
         const Method *method = tuple.method();
         const Interface *superInterface = tuple.interface();
 
-        if (!isIBase() && method->isHidlReserved()) {
-            continue;
-        }
         out << "case "
             << method->getSerialId()
             << " /* "
@@ -1336,43 +1375,83 @@ void AST::generateStubSource(Formatter& out, const Interface* iface) const {
 
     out << "default:\n{\n";
     out.indent();
-
-    if (iface->isIBase()) {
-        out << "(void)_hidl_flags;\n";
-        out << "return ::android::UNKNOWN_TRANSACTION;\n";
-    } else {
-        out << "return ";
-        out << gIBaseFqName.getInterfaceStubFqName().cppName();
-        out << "::onTransact(\n";
-
-        out.indent();
-        out.indent();
-
-        out << "_hidl_code, _hidl_data, _hidl_reply, "
-            << "_hidl_flags, _hidl_cb);\n";
-
-        out.unindent();
-        out.unindent();
-    }
-
+    out << "(void)_hidl_flags;\n";
+    out << "return ::android::UNKNOWN_TRANSACTION;\n";
     out.unindent();
     out << "}\n";
 
     out.unindent();
     out << "}\n\n";
+}
 
-    out.sIf("_hidl_err == ::android::UNEXPECTED_NULL", [&] {
-        out << "_hidl_err = ::android::hardware::writeToParcel(\n";
+void AST::generateStubTransactionTable(Formatter& out, const Interface* iface) const {
+    // Serial ids of methods which are not reserved run from
+    // FIRST_CALL_TRANSACTION (1), through the methods of each super
+    // interface, to this interface's last method. Everything else is handled
+    // by IBase.
+    std::vector<const Method*> methods;
+    std::vector<const Interface*> superInterfaces;
+    for (const auto& tuple : iface->allMethodsFromRoot()) {
+        if (tuple.method()->isHidlReserved()) {
+            continue;
+        }
+        CHECK(tuple.method()->getSerialId() == methods.size() + 1) << tuple.method()->name();
+        methods.push_back(tuple.method());
+        superInterfaces.push_back(tuple.interface());
+    }
+
+    const auto delegateToBase = [&] {
+        out << "return " << gIBaseFqName.getInterfaceStubFqName().cppName() << "::onTransact(\n";
         out.indent(2, [&] {
-            out << "::android::hardware::Status::fromExceptionCode(::android::hardware::Status::EX_NULL_POINTER),\n";
-            out << "_hidl_reply);\n";
+            out << "_hidl_code, _hidl_data, _hidl_reply, _hidl_flags, _hidl_cb);\n";
+        });
+    };
+
+    if (methods.empty()) {
+        out << "(void)_hidl_err;\n";
+        delegateToBase();
+        return;
+    }
+
+    out << "struct Transaction ";
+    out.block([&] {
+        out << "::android::status_t (*handler)(\n";
+        out.indent(2, [&] {
+            out << "::android::hidl::base::V1_0::BnHwBase* _hidl_this,\n"
+                << "const ::android::hardware::Parcel &_hidl_data,\n"
+                << "::android::hardware::Parcel *_hidl_reply,\n"
+                << "TransactCallback _hidl_cb);\n";
         });
+        out << "bool oneway;\n";
+        out << "const char* name;\n";
     });
+    out << ";\n\n";
 
-    out << "return _hidl_err;\n";
+    out << "// Indexed by _hidl_code - 1.\n";
+    out << "static constexpr Transaction kTransactions[] = ";
+    out.block([&] {
+        for (size_t i = 0; i < methods.size(); i++) {
+            const Method* method = methods[i];
+            out << "{&" << superInterfaces[i]->fqName().cppNamespace() << "::"
+                << superInterfaces[i]->getStubName() << "::_hidl_" << method->name() << ", "
+                << (method->isOneway() ? "true" : "false") << " /* oneway */, \""
+                << method->name() << "\"},\n";
+        }
+    });
+    out << ";\n\n";
 
-    out.unindent();
-    out << "}\n\n";
+    out << "const uint32_t _hidl_index = _hidl_code - 1;\n";
+    out.sIf("_hidl_index >= " + std::to_string(methods.size()), [&] {
+        delegateToBase();
+    }).endl().endl();
+
+    out << "const Transaction &_hidl_transaction = kTransactions[_hidl_index];\n";
+    out << "bool _hidl_is_oneway = _hidl_flags & " << Interface::FLAG_ONEWAY << " /* oneway */;\n";
+    out.sIf("_hidl_is_oneway != _hidl_transaction.oneway", [&] {
+        out << "return ::android::UNKNOWN_ERROR;\n";
+    }).endl().endl();
+
+    out << "_hidl_err = _hidl_transaction.handler(this, _hidl_data, _hidl_reply, _hidl_cb);\n\n";
 }
 
 void AST::generateStubSourceForMethod(Formatter& out, const Method* method,
@@ -1650,6 +1729,14 @@ void AST::generatePassthroughHeader(Formatter& out) const {
         out << "#include <hidl/TaskRunner.h>\n";
     }
 
+    // Also used by the proxy and stub, whose source includes this header.
+    out << "\n";
+    out << "// Instrumentation callbacks are called for every Nth call of a method on\n"
+        << "// a thread. Build with -DHIDL_INSTRUMENTATION_SAMPLE_RATE=N to sample.\n";
+    out << "#ifndef HIDL_INSTRUMENTATION_SAMPLE_RATE\n";
+    out << "#define HIDL_INSTRUMENTATION_SAMPLE_RATE 1\n";
+    out << "#endif\n\n";
+
     enterLeaveNamespace(out, true /* enter */);
     out << "\n";
 
@@ -1736,7 +1823,7 @@ void AST::generateInterfaceSource(Formatter& out) const {
         } else {
             out << "return ::android::hardware::details::castInterface<";
             out << iface->localName() << ", "
-                << superType->fqName().cppName() << ", "
+                << superType->fullName() << ", "
                 << iface->getProxyName()
                 << ">(\n";
             out.indent();
@@ -1845,20 +1932,18 @@ void AST::generateCppInstrumentationCall(
         const Method *method) const {
     generateCppAtraceCall(out, event, method);
 
-    out << "#ifdef __ANDROID_DEBUGGABLE__\n";
-    out << "if (UNLIKELY(mEnableInstrumentation)) {\n";
-    out.indent();
-    out << "std::vector<void *> _hidl_args;\n";
+    // Addresses of the arguments or results passed to the callbacks.
+    std::vector<std::string> args;
     std::string event_str = "";
+    bool isEntry = false;
     switch (event) {
         case SERVER_API_ENTRY:
         {
             event_str = "InstrumentationEvent::SERVER_API_ENTRY";
+            isEntry = true;
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)") +
+                               (arg->type().resultNeedsDeref() ? "" : "&") + arg->name());
             }
             break;
         }
@@ -1866,19 +1951,16 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::SERVER_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
         case CLIENT_API_ENTRY:
         {
             event_str = "InstrumentationEvent::CLIENT_API_ENTRY";
+            isEntry = true;
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1886,21 +1968,18 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::CLIENT_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << "_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)") +
+                               (arg->type().resultNeedsDeref() ? "" : "&") + "_hidl_out_" +
+                               arg->name());
             }
             break;
         }
         case PASSTHROUGH_ENTRY:
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_ENTRY";
+            isEntry = true;
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1908,9 +1987,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
@@ -1922,8 +1999,45 @@ void AST::generateCppInstrumentationCall(
 
     const Interface* iface = mRootScope.getInterface();
 
+    out << "#ifdef __ANDROID_DEBUGGABLE__\n";
+    if (isEntry) {
+        // Decided once per call, so that every call reports both or neither
+        // of its entry and exit.
+        out << "static thread_local uint32_t _hidl_instrumentation_count = 0;\n";
+        out << "const bool _hidl_instrumented = UNLIKELY(mEnableInstrumentation) &&\n";
+        out.indent(2, [&] {
+            out << "_hidl_instrumentation_count++ % HIDL_INSTRUMENTATION_SAMPLE_RATE == 0;\n";
+        });
+    }
+    out << "if (_hidl_instrumented) {\n";
+    out.indent();
+    if (!args.empty()) {
+        out << "void *_hidl_args_array[" << args.size() << "] = {";
+        out.join(args.begin(), args.end(), ", ", [&](const auto& arg) { out << arg; });
+        out << "};\n";
+    }
+    // The callbacks take a vector. This one keeps its capacity, so it is
+    // only allocated the first time on each thread. A callback which calls
+    // this method again still uses the outer call's vector, so the inner call
+    // fills a vector of its own instead.
+    out << "static thread_local std::vector<void *> _hidl_args_buffer;\n";
+    out << "static thread_local bool _hidl_args_buffer_in_use = false;\n";
+    out << "const bool _hidl_args_nested = _hidl_args_buffer_in_use;\n";
+    out << "std::vector<void *> _hidl_args_local;\n";
+    out << "std::vector<void *> *_hidl_args =\n";
+    out.indent(2, [&] {
+        out << "_hidl_args_nested ? &_hidl_args_local : &_hidl_args_buffer;\n";
+    });
+    out << "_hidl_args_buffer_in_use = true;\n";
     out << "for (const auto &callback: mInstrumentationCallbacks) {\n";
     out.indent();
+    // Refilled for each callback, since callbacks may change it.
+    if (args.empty()) {
+        out << "_hidl_args->clear();\n";
+    } else {
+        out << "_hidl_args->assign(_hidl_args_array, _hidl_args_array + " << args.size()
+            << ");\n";
+    }
     out << "callback("
         << event_str
         << ", \""
@@ -1934,9 +2048,10 @@ void AST::generateCppInstrumentationCall(
         << iface->localName()
         << "\", \""
         << method->name()
-        << "\", &_hidl_args);\n";
+        << "\", _hidl_args);\n";
     out.unindent();
     out << "}\n";
+    out << "_hidl_args_buffer_in_use = _hidl_args_nested;\n";
     out.unindent();
     out << "}\n";
     out << "#endif // __ANDROID_DEBUGGABLE__\n\n";
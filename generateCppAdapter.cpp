@@ -47,7 +47,7 @@ void AST::generateCppAdapterHeader(Formatter& out) const {
         enterLeaveNamespace(out, true /* enter */);
         out.endl();
 
-        const std::string mockName = getInterface()->fqName().cppName();
+        const std::string mockName = getInterface()->fullName();
 
         out << "class " << klassName << " : public " << mockName << " ";
         out.block([&] {
@@ -101,7 +101,7 @@ void AST::generateCppAdapterSource(Formatter& out) const {
         enterLeaveNamespace(out, true /* enter */);
         out.endl();
 
-        const std::string mockName = getInterface()->fqName().cppName();
+        const std::string mockName = getInterface()->fullName();
 
         out << klassName << "::" << klassName << "(::android::sp<" << mockName
             << "> impl) : mImpl(impl) {}";
@@ -136,10 +136,10 @@ void AST::generateAdapterMethod(Formatter& out, const Method* method) const {
         // is 1.0 ICallback, then wrap with a 1.0 adapter.
 
         const Interface* interface = static_cast<const Interface*>(type);
-        out << "static_cast<::android::sp<" << interface->fqName().cppName() << ">>("
-            << interface->fqName().cppName() << "::castFrom("
+        out << "static_cast<::android::sp<" << interface->fullName() << ">>("
+            << interface->fullName() << "::castFrom("
             << "::android::hardware::details::adaptWithDefault("
-            << "static_cast<::android::sp<" << interface->fqName().cppName() << ">>(" << var
+            << "static_cast<::android::sp<" << interface->fullName() << ">>(" << var
             << "), [&] { return new " << interface->fqName().getInterfaceAdapterFqName().cppName()
             << "(" << var << "); })))";
     };
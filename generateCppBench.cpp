@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <string>
+#include <vector>
+
+namespace android {
+
+static std::string benchName(const Method* method, const std::string& suffix) {
+    return "BM_" + method->name() + "_" + suffix;
+}
+
+static std::string resultMemberName(const Method* method, const NamedReference<Type>* result) {
+    return "mResult_" + method->name() + "_" + result->name();
+}
+
+static void emitBenchSeedLocals(Formatter& out, const std::string& size) {
+    out << "__attribute__((unused)) const size_t _hidl_size = " << size << ";\n";
+    out << "__attribute__((unused)) uint32_t _hidl_seed = 0;\n";
+}
+
+static void emitBenchFilledLocals(Formatter& out, const std::vector<NamedReference<Type>*>& args,
+                                  const std::string& prefix) {
+    for (const auto& arg : args) {
+        out << arg->type().getCppStackType() << " " << prefix << arg->name() << ";\n";
+        arg->type().emitCppBenchmarkFill(out, prefix + arg->name(), 0 /* depth */);
+    }
+}
+
+static void emitBenchRegistration(Formatter& out, const std::string& name) {
+    out << "BENCHMARK(" << name << ")->RangeMultiplier(8)->Range(1, 1 << 12);\n\n";
+}
+
+void AST::generateCppBenchMarshalling(Formatter& out, const Method* method,
+                                      bool forResults) const {
+    const std::vector<NamedReference<Type>*>& args =
+        forResults ? method->results() : method->args();
+
+    out << "static void " << benchName(method, forResults ? "results" : "args")
+        << "(::benchmark::State& state) ";
+    out.block([&] {
+        emitBenchSeedLocals(out, "static_cast<size_t>(state.range(0))");
+        emitBenchFilledLocals(out, args, forResults ? "_hidl_out_" : "");
+        out << "\n";
+
+        out << "for (auto _ : state) ";
+        out.block([&] {
+            out << "::android::hardware::Parcel _hidl_parcel;\n";
+            out << "::android::status_t _hidl_err = [&]() -> ::android::status_t ";
+            out.block([&] {
+                out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+                for (const auto& arg : args) {
+                    emitCppReaderWriter(out, "_hidl_parcel", false /* parcelObjIsPointer */, arg,
+                                        false /* reader */, Type::ErrorMode_Return, forResults);
+                }
+                for (const auto& arg : args) {
+                    emitCppResolveReferences(out, "_hidl_parcel", false /* parcelObjIsPointer */,
+                                             arg, false /* reader */, Type::ErrorMode_Return,
+                                             forResults);
+                }
+                out << "return _hidl_err;\n";
+            });
+            out << "();\n\n";
+
+            out << "if (_hidl_err == ::android::OK) ";
+            out.block([&] {
+                out << "_hidl_parcel.setDataPosition(0);\n";
+                out << "_hidl_err = [&]() -> ::android::status_t ";
+                out.block([&] {
+                    out << "::android::status_t _hidl_err = ::android::OK;\n\n";
+                    declareCppReaderLocals(out, args, forResults);
+                    for (const auto& arg : args) {
+                        emitCppReaderWriter(out, "_hidl_parcel", false /* parcelObjIsPointer */,
+                                            arg, true /* reader */, Type::ErrorMode_Return,
+                                            forResults);
+                    }
+                    for (const auto& arg : args) {
+                        emitCppResolveReferences(out, "_hidl_parcel",
+                                                 false /* parcelObjIsPointer */, arg,
+                                                 true /* reader */, Type::ErrorMode_Return,
+                                                 forResults);
+                    }
+                    for (const auto& arg : args) {
+                        out << "::benchmark::DoNotOptimize("
+                            << (forResults ? "_hidl_out_" : "") << arg->name() << ");\n";
+                    }
+                    out << "return _hidl_err;\n";
+                });
+                out << "();\n";
+            }).endl();
+
+            out << "if (_hidl_err != ::android::OK) ";
+            out.block([&] {
+                out << "state.SkipWithError(\"" << method->name()
+                    << (forResults ? " results" : " arguments")
+                    << " failed to round-trip\");\n";
+                out << "break;\n";
+            }).endl();
+        }).endl();
+    }).endl().endl();
+
+    emitBenchRegistration(out, benchName(method, forResults ? "results" : "args"));
+}
+
+void AST::generateCppBenchSource(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no methods to benchmark.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::string implName = "Bench" + iface->getBaseName();
+
+    generateCppPackageInclude(out, mPackage, iface->localName());
+    generateCppPackageInclude(out, mPackage, iface->getProxyName());
+    generateCppPackageInclude(out, mPackage, iface->getStubName());
+
+    out << "\n";
+    out << "#include <benchmark/benchmark.h>\n";
+    out << "#include <hidl/HidlTransportSupport.h>\n\n";
+    out << "#include <algorithm>\n\n";
+
+    out << "namespace {\n\n";
+
+    // Returns canned results so that the _call benchmarks measure marshalling
+    // and dispatch only. The results are filled once, they outlive every call.
+    out << "struct " << implName << " : public " << iface->fullName() << " ";
+    out.block([&] {
+        out << "explicit " << implName << "(size_t size) ";
+        out.block([&] {
+            emitBenchSeedLocals(out, "size");
+            generateMethods(out, [&](const Method* method, const Interface*) {
+                if (method->isHidlReserved()) {
+                    return;
+                }
+                for (const auto& result : method->results()) {
+                    result->type().emitCppBenchmarkFill(out, resultMemberName(method, result),
+                                                        0 /* depth */);
+                }
+            });
+        }).endl().endl();
+
+        generateMethods(out, [&](const Method* method, const Interface*) {
+            // implemented in IBase already.
+            if (method->isHidlReserved()) {
+                return;
+            }
+
+            method->generateCppSignature(out);
+            out << " override ";
+            out.block([&] {
+                const NamedReference<Type>* elidedReturn = method->canElideCallback();
+                if (elidedReturn != nullptr) {
+                    out << "return " << resultMemberName(method, elidedReturn) << ";\n";
+                    return;
+                }
+                if (!method->results().empty()) {
+                    out << "_hidl_cb(";
+                    out.join(method->results().begin(), method->results().end(), ", ",
+                             [&](const auto& result) {
+                                 out << resultMemberName(method, result);
+                             });
+                    out << ");\n";
+                }
+                out << "return ::android::hardware::Void();\n";
+            }).endl().endl();
+        });
+
+        generateMethods(out, [&](const Method* method, const Interface*) {
+            if (method->isHidlReserved()) {
+                return;
+            }
+            for (const auto& result : method->results()) {
+                out << result->type().getCppStackType() << " "
+                    << resultMemberName(method, result) << ";\n";
+            }
+        });
+    });
+    out << ";\n\n";
+
+    generateMethods(out, [&](const Method* method, const Interface*) {
+        if (method->isHidlReserved()) {
+            return;
+        }
+
+        if (!method->args().empty()) {
+            generateCppBenchMarshalling(out, method, false /* forResults */);
+        }
+        if (!method->results().empty()) {
+            generateCppBenchMarshalling(out, method, true /* forResults */);
+        }
+
+        // A proxy talking to an in-process stub: both sides of the
+        // transaction are exercised, the kernel driver is not.
+        out << "static void " << benchName(method, "call") << "(::benchmark::State& state) ";
+        out.block([&] {
+            emitBenchSeedLocals(out, "static_cast<size_t>(state.range(0))");
+            emitBenchFilledLocals(out, method->args(), "" /* prefix */);
+            out << "::android::sp<" << iface->fullName() << "> proxy = new "
+                << iface->fqName().cppNamespace() << "::" << iface->getProxyName()
+                << "(new " << iface->fqName().cppNamespace()
+                << "::" << iface->getStubName() << "(new " << implName << "(_hidl_size)));\n\n";
+
+            out << "for (auto _ : state) ";
+            out.block([&] {
+                out << "auto _hidl_return = proxy->" << method->name() << "(";
+                out.join(method->args().begin(), method->args().end(), ", ",
+                         [&](const auto& arg) { out << arg->name(); });
+                if (!method->results().empty() && method->canElideCallback() == nullptr) {
+                    out << (method->args().empty() ? "" : ", ") << "[](auto&&...) {}";
+                }
+                out << ");\n";
+
+                out << "if (!_hidl_return.isOk()) ";
+                out.block([&] {
+                    out << "state.SkipWithError(_hidl_return.description().c_str());\n";
+                    out << "break;\n";
+                }).endl();
+            }).endl();
+        }).endl().endl();
+
+        emitBenchRegistration(out, benchName(method, "call"));
+    });
+
+    out << "}  // namespace\n\n";
+
+    out << "BENCHMARK_MAIN();\n";
+}
+
+}  // namespace android
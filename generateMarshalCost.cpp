@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace android {
+
+static Type::MarshalCost marshalCostOf(const NamedReference<Type>* arg) {
+    Type::MarshalCost cost;
+    arg->type().addMarshalCost(&cost);
+    return cost;
+}
+
+static Type::MarshalCost marshalCostOf(const std::vector<NamedReference<Type>*>& args) {
+    Type::MarshalCost total;
+    for (const auto& arg : args) {
+        total.addRepeated(marshalCostOf(arg), 1 /* count */);
+    }
+    return total;
+}
+
+static bool needsResolveReferences(const std::vector<NamedReference<Type>*>& args) {
+    for (const auto& arg : args) {
+        if (arg->type().needsResolveReferences()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void emitMarshalCostJsonFields(Formatter& out, const Type::MarshalCost& cost,
+                                      bool needsResolveReferences) {
+    out << "\"bytes\": " << cost.bytes << ",\n";
+    out << "\"bufferObjects\": " << cost.bufferObjects << ",\n";
+    out << "\"fdArrayObjects\": " << cost.fdArrayObjects << ",\n";
+    out << "\"binderObjects\": " << cost.binderObjects << ",\n";
+    out << "\"depth\": " << cost.depth << ",\n";
+    out << "\"variableSize\": " << (cost.variableSize ? "true" : "false") << ",\n";
+    out << "\"recursive\": " << (cost.recursive ? "true" : "false") << ",\n";
+    out << "\"needsResolveReferences\": " << (needsResolveReferences ? "true" : "false");
+}
+
+static void emitMarshalCostJsonDirection(Formatter& out,
+                                         const std::vector<NamedReference<Type>*>& args) {
+    out << "{\n";
+    out.indent([&] {
+        emitMarshalCostJsonFields(out, marshalCostOf(args), needsResolveReferences(args));
+        out << ",\n\"params\": [";
+        out.indent([&] {
+            out.join(args.begin(), args.end(), ",", [&](const auto& arg) {
+                out << "\n{\n";
+                out.indent([&] {
+                    out << "\"name\": \"" << arg->name() << "\",\n";
+                    out << "\"type\": \"" << arg->type().typeName() << "\",\n";
+                    emitMarshalCostJsonFields(out, marshalCostOf(arg),
+                                              arg->type().needsResolveReferences());
+                    out << "\n";
+                });
+                out << "}";
+            });
+        });
+        out << (args.empty() ? "" : "\n") << "]\n";
+    });
+    out << "}";
+}
+
+void AST::generateMarshalCostJson(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no methods.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+    const std::vector<Method*>& methods = iface->userDefinedMethods();
+
+    out << "{\n";
+    out.indent([&] {
+        out << "\"interface\": \"" << iface->fqName().string() << "\",\n";
+        out << "\"methods\": [";
+        out.indent([&] {
+            out.join(methods.begin(), methods.end(), ",", [&](const Method* method) {
+                out << "\n{\n";
+                out.indent([&] {
+                    out << "\"name\": \"" << method->name() << "\",\n";
+                    out << "\"oneway\": " << (method->isOneway() ? "true" : "false") << ",\n";
+                    out << "\"args\": ";
+                    emitMarshalCostJsonDirection(out, method->args());
+                    out << ",\n\"results\": ";
+                    emitMarshalCostJsonDirection(out, method->results());
+                    out << "\n";
+                });
+                out << "}";
+            });
+        });
+        out << (methods.empty() ? "" : "\n") << "]\n";
+    });
+    out << "}\n";
+}
+
+void AST::generateMarshalCostTable(Formatter& out) const {
+    if (!AST::isInterface()) {
+        // types.hal has no methods.
+        return;
+    }
+
+    const Interface* iface = mRootScope.getInterface();
+
+    const std::vector<std::string> header = {"method", "dir",    "bytes", "buffers",
+                                             "fds",    "binders", "depth", "resolve"};
+    std::vector<std::vector<std::string>> rows;
+
+    for (const Method* method : iface->userDefinedMethods()) {
+        for (bool forResults : {false, true}) {
+            const std::vector<NamedReference<Type>*>& args =
+                forResults ? method->results() : method->args();
+            if (args.empty()) {
+                continue;
+            }
+
+            const Type::MarshalCost cost = marshalCostOf(args);
+            rows.push_back({
+                method->name(),
+                forResults ? "out" : "in",
+                std::to_string(cost.bytes) + (cost.variableSize ? "+" : "") +
+                    (cost.recursive ? "*" : ""),
+                std::to_string(cost.bufferObjects),
+                std::to_string(cost.fdArrayObjects),
+                std::to_string(cost.binderObjects),
+                std::to_string(cost.depth),
+                needsResolveReferences(args) ? "yes" : "no",
+            });
+        }
+    }
+
+    std::vector<size_t> widths;
+    for (const std::string& column : header) {
+        widths.push_back(column.size());
+    }
+    for (const auto& row : rows) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            widths[i] = std::max(widths[i], row[i].size());
+        }
+    }
+
+    auto emitRow = [&](const std::vector<std::string>& row) {
+        std::ostringstream line;
+        for (size_t i = 0; i < row.size(); ++i) {
+            // Names are left aligned, numbers right aligned.
+            line << (i < 2 ? std::left : std::right) << std::setw(widths[i]) << row[i]
+                 << (i + 1 < row.size() ? "  " : "");
+        }
+        out << line.str() << "\n";
+    };
+
+    out << iface->fqName().string() << "\n\n";
+    emitRow(header);
+    for (const auto& row : rows) {
+        emitRow(row);
+    }
+
+    out << "\n"
+        << "bytes: fixed bytes copied, '+' if there is a data dependent part on top,\n"
+        << "       '*' if a recursive struct makes it unbounded.\n"
+        << "depth: longest chain of buffers embedded in one another.\n";
+}
+
+}  // namespace android
@@ -18,15 +18,15 @@
 
 #include "AST.h"
 
+#include <hidl-util/SourceFile.h>
 #include <utils/Errors.h>
 
-#include <stdio.h>
-
 namespace android {
 
 // entry-point for file parsing
 // - contents of file are added to the AST
-// - expects file to already be open
-status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE*)>> file);
+// - the file is scanned in place and is modified while scanning: pass a
+//   mapping of its own, from SourceFile::open, and hash it before
+status_t parseFile(AST* ast, SourceFile* file);
 
 }  // namespace android
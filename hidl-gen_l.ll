@@ -48,19 +48,33 @@ FQNAME              ({COMPONENT}|{VERSION})(({DOT}|":"+){COMPONENT}|{VERSION})*
 #include "RefType.h"
 #include "FmqType.h"
 
+#include "hidl-gen_l.h"
 #include "hidl-gen_y.hpp"
 
+#include <android-base/logging.h>
 #include <assert.h>
 
 using namespace android;
 using token = yy::parser::token;
 
-static std::string gCurrentComment;
+namespace android {
+
+// Everything one parse needs besides the scanner's own state, reachable
+// through yyextra. There is no global state, so any number of files may be
+// parsed at the same time on different threads.
+struct ParseContext {
+    AST* const ast;
+
+    // Text of the doc comment being scanned.
+    std::string currentComment;
+};
 
-#define SCALAR_TYPE(kind)                                        \
-    {                                                            \
-        yylval->type = new ScalarType(ScalarType::kind, *scope); \
-        return token::TYPE;                                      \
+}  // namespace android
+
+#define SCALAR_TYPE(kind)                                                                   \
+    {                                                                                       \
+        yylval->type = yyextra->ast->getArena().make<ScalarType>(ScalarType::kind, *scope); \
+        return token::TYPE;                                                                 \
     }
 
 #define YY_DECL int yylex(YYSTYPE* yylval_param, YYLTYPE* yylloc_param,  \
@@ -80,6 +94,7 @@ static std::string gCurrentComment;
 %option nounput
 %option noinput
 %option reentrant
+%option extra-type="android::ParseContext*"
 %option bison-bridge
 %option bison-locations
 
@@ -88,15 +103,16 @@ static std::string gCurrentComment;
 
 %%
 
-"/**"                       { gCurrentComment.clear(); BEGIN(DOC_COMMENT_STATE); }
+"/**"                       { yyextra->currentComment.clear(); BEGIN(DOC_COMMENT_STATE); }
 <DOC_COMMENT_STATE>"*/"     {
                                 BEGIN(INITIAL);
-                                yylval->docComment = new DocComment(gCurrentComment);
+                                yylval->docComment =
+                                    yyextra->ast->getArena().make<DocComment>(yyextra->currentComment);
                                 return token::DOC_COMMENT;
                             }
-<DOC_COMMENT_STATE>[^*\n]*                          { gCurrentComment += yytext; }
-<DOC_COMMENT_STATE>[\n]                             { gCurrentComment += yytext; yylloc->lines(); }
-<DOC_COMMENT_STATE>[*]                              { gCurrentComment += yytext; }
+<DOC_COMMENT_STATE>[^*\n]*                          { yyextra->currentComment += yytext; }
+<DOC_COMMENT_STATE>[\n]                             { yyextra->currentComment += yytext; yylloc->lines(); }
+<DOC_COMMENT_STATE>[*]                              { yyextra->currentComment += yytext; }
 
 "/*"                        { BEGIN(COMMENT_STATE); }
 <COMMENT_STATE>"*/"         { BEGIN(INITIAL); }
@@ -114,9 +130,9 @@ static std::string gCurrentComment;
 "struct"            { return token::STRUCT; }
 "typedef"           { return token::TYPEDEF; }
 "union"             { return token::UNION; }
-"bitfield"          { yylval->templatedType = new BitFieldType(*scope); return token::TEMPLATED; }
-"vec"               { yylval->templatedType = new VectorType(*scope); return token::TEMPLATED; }
-"ref"               { yylval->templatedType = new RefType(*scope); return token::TEMPLATED; }
+"bitfield"          { yylval->templatedType = yyextra->ast->getArena().make<BitFieldType>(*scope); return token::TEMPLATED; }
+"vec"               { yylval->templatedType = yyextra->ast->getArena().make<VectorType>(*scope); return token::TEMPLATED; }
+"ref"               { yylval->templatedType = yyextra->ast->getArena().make<RefType>(*scope); return token::TEMPLATED; }
 "oneway"            { return token::ONEWAY; }
 
 "bool"              { SCALAR_TYPE(KIND_BOOL); }
@@ -131,14 +147,14 @@ static std::string gCurrentComment;
 "float"             { SCALAR_TYPE(KIND_FLOAT); }
 "double"            { SCALAR_TYPE(KIND_DOUBLE); }
 
-"death_recipient"   { yylval->type = new DeathRecipientType(*scope); return token::TYPE; }
-"handle"            { yylval->type = new HandleType(*scope); return token::TYPE; }
-"memory"            { yylval->type = new MemoryType(*scope); return token::TYPE; }
-"pointer"           { yylval->type = new PointerType(*scope); return token::TYPE; }
-"string"            { yylval->type = new StringType(*scope); return token::TYPE; }
+"death_recipient"   { yylval->type = yyextra->ast->getArena().make<DeathRecipientType>(*scope); return token::TYPE; }
+"handle"            { yylval->type = yyextra->ast->getArena().make<HandleType>(*scope); return token::TYPE; }
+"memory"            { yylval->type = yyextra->ast->getArena().make<MemoryType>(*scope); return token::TYPE; }
+"pointer"           { yylval->type = yyextra->ast->getArena().make<PointerType>(*scope); return token::TYPE; }
+"string"            { yylval->type = yyextra->ast->getArena().make<StringType>(*scope); return token::TYPE; }
 
-"fmq_sync"          { yylval->type = new FmqType("::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
-"fmq_unsync"        { yylval->type = new FmqType("::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
+"fmq_sync"          { yylval->type = yyextra->ast->getArena().make<FmqType>("::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
+"fmq_unsync"        { yylval->type = yyextra->ast->getArena().make<FmqType>("::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
 
 "("                 { return('('); }
 ")"                 { return(')'); }
@@ -174,22 +190,22 @@ static std::string gCurrentComment;
 "?"                 { return('?'); }
 "@"                 { return('@'); }
 
-{COMPONENT}         { yylval->str = strdup(yytext); return token::IDENTIFIER; }
-{FQNAME}            { yylval->str = strdup(yytext); return token::FQNAME; }
+{COMPONENT}         { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::IDENTIFIER; }
+{FQNAME}            { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::FQNAME; }
 
-0[xX]{H}+{IS}?      { yylval->str = strdup(yytext); return token::INTEGER; }
-0{D}+{IS}?          { yylval->str = strdup(yytext); return token::INTEGER; }
-{D}+{IS}?           { yylval->str = strdup(yytext); return token::INTEGER; }
-L?\"(\\.|[^\\"])*\" { yylval->str = strdup(yytext); return token::STRING_LITERAL; }
+0[xX]{H}+{IS}?      { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::INTEGER; }
+0{D}+{IS}?          { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::INTEGER; }
+{D}+{IS}?           { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::INTEGER; }
+L?\"(\\.|[^\\"])*\" { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::STRING_LITERAL; }
 
-{D}+{E}{FS}?        { yylval->str = strdup(yytext); return token::FLOAT; }
-{D}+\.{E}?{FS}?     { yylval->str = strdup(yytext); return token::FLOAT; }
-{D}*\.{D}+{E}?{FS}? { yylval->str = strdup(yytext); return token::FLOAT; }
+{D}+{E}{FS}?        { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::FLOAT; }
+{D}+\.{E}?{FS}?     { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::FLOAT; }
+{D}*\.{D}+{E}?{FS}? { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::FLOAT; }
 
 \n|\r\n             { yylloc->lines(); }
 [ \t\f\v]           { /* ignore all other whitespace */ }
 
-.                   { yylval->str = strdup(yytext); return token::UNKNOWN; }
+.                   { yylval->str = yyextra->ast->getArena().copyString(yytext); return token::UNKNOWN; }
 
 %%
 
@@ -197,15 +213,19 @@ L?\"(\\.|[^\\"])*\" { yylval->str = strdup(yytext); return token::STRING_LITERAL
 
 namespace android {
 
-status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE *)>> file) {
+status_t parseFile(AST* ast, SourceFile* file) {
+    ParseContext context{ast, ""};
+
     yyscan_t scanner;
-    yylex_init(&scanner);
+    yylex_init_extra(&context, &scanner);
 
-    yyset_in(file.get(), scanner);
+    YY_BUFFER_STATE buffer = yy_scan_buffer(file->scanBuffer(), file->scanBufferSize(), scanner);
+    CHECK(buffer != nullptr) << file->path();
 
     Scope* scopeStack = ast->getRootScope();
     int res = yy::parser(scanner, ast, &scopeStack).parse();
 
+    yy_delete_buffer(buffer, scanner);
     yylex_destroy(scanner);
 
     if (res != 0 || ast->syntaxErrors() != 0) {
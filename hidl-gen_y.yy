@@ -372,7 +372,7 @@ valid_type_name
 opt_annotations
     : /* empty */
       {
-          $$ = new std::vector<Annotation *>;
+          $$ = ast->getArena().make<std::vector<Annotation *>>();
       }
     | opt_annotations annotation
       {
@@ -384,14 +384,14 @@ opt_annotations
 annotation
     : '@' IDENTIFIER opt_annotation_params
       {
-          $$ = new Annotation($2, $3);
+          $$ = ast->getArena().make<Annotation>($2, $3);
       }
     ;
 
 opt_annotation_params
     : /* empty */
       {
-          $$ = new AnnotationParamVector;
+          $$ = ast->getArena().make<AnnotationParamVector>();
       }
     | '(' annotation_params ')'
       {
@@ -402,7 +402,7 @@ opt_annotation_params
 annotation_params
     : annotation_param
       {
-          $$ = new AnnotationParamVector;
+          $$ = ast->getArena().make<AnnotationParamVector>();
           $$->push_back($1);
       }
     | annotation_params ',' annotation_param
@@ -415,18 +415,18 @@ annotation_params
 annotation_param
     : IDENTIFIER '=' annotation_string_value
       {
-          $$ = new StringAnnotationParam($1, $3);
+          $$ = ast->getArena().make<StringAnnotationParam>($1, $3);
       }
     | IDENTIFIER '=' annotation_const_expr_value
       {
-          $$ = new ConstantExpressionAnnotationParam($1, $3);
+          $$ = ast->getArena().make<ConstantExpressionAnnotationParam>($1, $3);
       }
     ;
 
 annotation_string_value
     : STRING_LITERAL
       {
-          $$ = new std::vector<std::string>;
+          $$ = ast->getArena().make<std::vector<std::string>>();
           $$->push_back($1);
       }
     | '{' annotation_string_values '}' { $$ = $2; }
@@ -435,7 +435,7 @@ annotation_string_value
 annotation_string_values
     : STRING_LITERAL
       {
-          $$ = new std::vector<std::string>;
+          $$ = ast->getArena().make<std::vector<std::string>>();
           $$->push_back($1);
       }
     | annotation_string_values ',' STRING_LITERAL
@@ -448,7 +448,7 @@ annotation_string_values
 annotation_const_expr_value
     : const_expr
       {
-          $$ = new std::vector<ConstantExpression *>;
+          $$ = ast->getArena().make<std::vector<ConstantExpression *>>();
           $$->push_back($1);
       }
     | '{' annotation_const_expr_values '}' { $$ = $2; }
@@ -457,7 +457,7 @@ annotation_const_expr_value
 annotation_const_expr_values
     : const_expr
       {
-          $$ = new std::vector<ConstantExpression *>;
+          $$ = ast->getArena().make<std::vector<ConstantExpression *>>();
           $$->push_back($1);
       }
     | annotation_const_expr_values ',' const_expr
@@ -487,7 +487,7 @@ require_semicolon
 fqname
     : FQNAME
       {
-          $$ = new FQName();
+          $$ = ast->getArena().make<FQName>();
           if(!FQName::parse($1, $$)) {
               std::cerr << "ERROR: FQName '" << $1 << "' is not valid at "
                         << @1
@@ -497,7 +497,7 @@ fqname
       }
     | valid_type_name
       {
-          $$ = new FQName();
+          $$ = ast->getArena().make<FQName>();
           if(!FQName::parse($1, $$)) {
               std::cerr << "ERROR: FQName '" << $1 << "' is not valid at "
                         << @1
@@ -510,11 +510,11 @@ fqname
 fqtype
     : fqname
       {
-          $$ = new Reference<Type>(*$1, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>(*$1, convertYYLoc(@1));
       }
     | TYPE
       {
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>($1, convertYYLoc(@1));
       }
     ;
 
@@ -664,7 +664,7 @@ interface_declaration
 
                   YYERROR;
               }
-              superType = new Reference<Type>();
+              superType = ast->getArena().make<Reference<Type>>();
           } else {
               if (!ast->addImport(gIBaseFqName.string().c_str())) {
                   std::cerr << "ERROR: Unable to automatically import '"
@@ -675,7 +675,7 @@ interface_declaration
               }
 
               if (superType == nullptr) {
-                  superType = new Reference<Type>(gIBaseFqName, convertYYLoc(@$));
+                  superType = ast->getArena().make<Reference<Type>>(gIBaseFqName, convertYYLoc(@$));
               }
           }
 
@@ -693,7 +693,7 @@ interface_declaration
               YYERROR;
           }
 
-          Interface* iface = new Interface(
+          Interface* iface = ast->getArena().make<Interface>(
               $2, ast->makeFullName($2, *scope), convertYYLoc(@2),
               *scope, *superType, ast->getFileHash());
 
@@ -704,7 +704,15 @@ interface_declaration
           CHECK((*scope)->isInterface());
 
           Interface *iface = static_cast<Interface *>(*scope);
-          CHECK(iface->addAllReservedMethods());
+
+          // IBase was imported above, and is owned by the same Coordinator.
+          const Interface* iBase = iface;
+          if (!iface->isIBase()) {
+              Type* type = ast->lookupType(gIBaseFqName, *scope);
+              CHECK(type != nullptr && type->isInterface());
+              iBase = static_cast<const Interface*>(type);
+          }
+          CHECK(iface->addAllReservedMethods(*iBase, &ast->getArena()));
 
           leaveScope(ast, scope);
           ast->addScopedType(iface, *scope);
@@ -718,7 +726,7 @@ typedef_declaration
           // The reason we wrap the given type in a TypeDef is simply to suppress
           // emitting any type definitions later on, since this is just an alias
           // to a type defined elsewhere.
-          TypeDef* typeDef = new TypeDef(
+          TypeDef* typeDef = ast->getArena().make<TypeDef>(
               $3, ast->makeFullName($3, *scope), convertYYLoc(@2), *scope, *$2);
           ast->addScopedType(typeDef, *scope);
           $$ = typeDef;
@@ -744,35 +752,35 @@ const_expr
               YYERROR;
           }
 
-          $$ = new ReferenceConstantExpression(
+          $$ = ast->getArena().make<ReferenceConstantExpression>(
               Reference<LocalIdentifier>(*$1, convertYYLoc(@1)), $1->string());
       }
     | const_expr '?' const_expr ':' const_expr
       {
-          $$ = new TernaryConstantExpression($1, $3, $5);
-      }
-    | const_expr LOGICAL_OR const_expr  { $$ = new BinaryConstantExpression($1, "||", $3); }
-    | const_expr LOGICAL_AND const_expr { $$ = new BinaryConstantExpression($1, "&&", $3); }
-    | const_expr '|' const_expr { $$ = new BinaryConstantExpression($1, "|" , $3); }
-    | const_expr '^' const_expr { $$ = new BinaryConstantExpression($1, "^" , $3); }
-    | const_expr '&' const_expr { $$ = new BinaryConstantExpression($1, "&" , $3); }
-    | const_expr EQUALITY const_expr { $$ = new BinaryConstantExpression($1, "==", $3); }
-    | const_expr NEQ const_expr { $$ = new BinaryConstantExpression($1, "!=", $3); }
-    | const_expr '<' const_expr { $$ = new BinaryConstantExpression($1, "<" , $3); }
-    | const_expr '>' const_expr { $$ = new BinaryConstantExpression($1, ">" , $3); }
-    | const_expr LEQ const_expr { $$ = new BinaryConstantExpression($1, "<=", $3); }
-    | const_expr GEQ const_expr { $$ = new BinaryConstantExpression($1, ">=", $3); }
-    | const_expr LSHIFT const_expr { $$ = new BinaryConstantExpression($1, "<<", $3); }
-    | const_expr RSHIFT const_expr { $$ = new BinaryConstantExpression($1, ">>", $3); }
-    | const_expr '+' const_expr { $$ = new BinaryConstantExpression($1, "+" , $3); }
-    | const_expr '-' const_expr { $$ = new BinaryConstantExpression($1, "-" , $3); }
-    | const_expr '*' const_expr { $$ = new BinaryConstantExpression($1, "*" , $3); }
-    | const_expr '/' const_expr { $$ = new BinaryConstantExpression($1, "/" , $3); }
-    | const_expr '%' const_expr { $$ = new BinaryConstantExpression($1, "%" , $3); }
-    | '+' const_expr %prec UNARY_PLUS  { $$ = new UnaryConstantExpression("+", $2); }
-    | '-' const_expr %prec UNARY_MINUS { $$ = new UnaryConstantExpression("-", $2); }
-    | '!' const_expr { $$ = new UnaryConstantExpression("!", $2); }
-    | '~' const_expr { $$ = new UnaryConstantExpression("~", $2); }
+          $$ = ast->getArena().make<TernaryConstantExpression>($1, $3, $5);
+      }
+    | const_expr LOGICAL_OR const_expr  { $$ = ast->getArena().make<BinaryConstantExpression>($1, "||", $3); }
+    | const_expr LOGICAL_AND const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "&&", $3); }
+    | const_expr '|' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "|" , $3); }
+    | const_expr '^' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "^" , $3); }
+    | const_expr '&' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "&" , $3); }
+    | const_expr EQUALITY const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "==", $3); }
+    | const_expr NEQ const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "!=", $3); }
+    | const_expr '<' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "<" , $3); }
+    | const_expr '>' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, ">" , $3); }
+    | const_expr LEQ const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "<=", $3); }
+    | const_expr GEQ const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, ">=", $3); }
+    | const_expr LSHIFT const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "<<", $3); }
+    | const_expr RSHIFT const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, ">>", $3); }
+    | const_expr '+' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "+" , $3); }
+    | const_expr '-' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "-" , $3); }
+    | const_expr '*' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "*" , $3); }
+    | const_expr '/' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "/" , $3); }
+    | const_expr '%' const_expr { $$ = ast->getArena().make<BinaryConstantExpression>($1, "%" , $3); }
+    | '+' const_expr %prec UNARY_PLUS  { $$ = ast->getArena().make<UnaryConstantExpression>("+", $2); }
+    | '-' const_expr %prec UNARY_MINUS { $$ = ast->getArena().make<UnaryConstantExpression>("-", $2); }
+    | '!' const_expr { $$ = ast->getArena().make<UnaryConstantExpression>("!", $2); }
+    | '~' const_expr { $$ = ast->getArena().make<UnaryConstantExpression>("~", $2); }
     | '(' const_expr ')' { $$ = $2; }
     | '(' error ')'
       {
@@ -797,18 +805,18 @@ method_declaration
     : error_stmt { $$ = nullptr; }
     | opt_annotations valid_identifier '(' typed_vars ')' require_semicolon
       {
-          $$ = new Method($2 /* name */,
+          $$ = ast->getArena().make<Method>($2 /* name */,
                           $4 /* args */,
-                          new std::vector<NamedReference<Type>*> /* results */,
+                          ast->getArena().make<std::vector<NamedReference<Type>*>>() /* results */,
                           false /* oneway */,
                           $1 /* annotations */,
                           convertYYLoc(@$));
       }
     | opt_annotations ONEWAY valid_identifier '(' typed_vars ')' require_semicolon
       {
-          $$ = new Method($3 /* name */,
+          $$ = ast->getArena().make<Method>($3 /* name */,
                           $5 /* args */,
-                          new std::vector<NamedReference<Type>*> /* results */,
+                          ast->getArena().make<std::vector<NamedReference<Type>*>>() /* results */,
                           true /* oneway */,
                           $1 /* annotations */,
                           convertYYLoc(@$));
@@ -820,7 +828,7 @@ method_declaration
               ast->addSyntaxError();
           }
 
-          $$ = new Method($2 /* name */,
+          $$ = ast->getArena().make<Method>($2 /* name */,
                           $4 /* args */,
                           $8 /* results */,
                           false /* oneway */,
@@ -832,11 +840,11 @@ method_declaration
 typed_vars
     : /* empty */
       {
-          $$ = new TypedVarVector();
+          $$ = ast->getArena().make<TypedVarVector>();
       }
     | typed_var
       {
-          $$ = new TypedVarVector();
+          $$ = ast->getArena().make<TypedVarVector>();
           if (!$$->add($1)) {
               std::cerr << "ERROR: duplicated argument or result name "
                   << $1->name() << " at " << @1 << "\n";
@@ -857,11 +865,11 @@ typed_vars
 typed_var
     : type valid_identifier
       {
-          $$ = new NamedReference<Type>($2, *$1, convertYYLoc(@2));
+          $$ = ast->getArena().make<NamedReference<Type>>($2, *$1, convertYYLoc(@2));
       }
     | type
       {
-          $$ = new NamedReference<Type>("", *$1, convertYYLoc(@1));
+          $$ = ast->getArena().make<NamedReference<Type>>("", *$1, convertYYLoc(@1));
 
           const std::string typeName = $$->isResolved()
               ? $$->get()->typeName() : $$->getLookupFqName().string();
@@ -881,7 +889,7 @@ struct_or_union_keyword
 named_struct_or_union_declaration
     : struct_or_union_keyword valid_type_name
       {
-          CompoundType *container = new CompoundType(
+          CompoundType *container = ast->getArena().make<CompoundType>(
               $1, $2, ast->makeFullName($2, *scope), convertYYLoc(@2), *scope);
           enterScope(ast, scope, container);
       }
@@ -902,7 +910,7 @@ struct_or_union_body
     ;
 
 field_declarations
-    : /* empty */ { $$ = new std::vector<NamedReference<Type>*>; }
+    : /* empty */ { $$ = ast->getArena().make<std::vector<NamedReference<Type>*>>(); }
     | field_declarations commentable_field_declaration
       {
           $$ = $1;
@@ -935,7 +943,7 @@ field_declaration
                         << @2 << "\n";
               YYERROR;
           }
-          $$ = new NamedReference<Type>($2, *$1, convertYYLoc(@2));
+          $$ = ast->getArena().make<NamedReference<Type>>($2, *$1, convertYYLoc(@2));
       }
     | annotated_compound_declaration ';'
       {
@@ -987,11 +995,11 @@ named_enum_declaration
               std::cerr << "ERROR: Must explicitly specify enum storage type for "
                         << $2 << " at " << @2 << "\n";
               ast->addSyntaxError();
-              storageType = new Reference<Type>(
-                  new ScalarType(ScalarType::KIND_INT64, *scope), convertYYLoc(@2));
+              storageType = ast->getArena().make<Reference<Type>>(
+                  ast->getArena().make<ScalarType>(ScalarType::KIND_INT64, *scope), convertYYLoc(@2));
           }
 
-          EnumType* enumType = new EnumType(
+          EnumType* enumType = ast->getArena().make<EnumType>(
               $2, ast->makeFullName($2, *scope), convertYYLoc(@2), *storageType, *scope);
           enterScope(ast, scope, enumType);
       }
@@ -1022,11 +1030,11 @@ commentable_enum_value
 enum_value
     : valid_identifier
       {
-          $$ = new EnumValue($1 /* name */, nullptr /* value */, convertYYLoc(@$));
+          $$ = ast->getArena().make<EnumValue>($1 /* name */, nullptr /* value */, convertYYLoc(@$));
       }
     | valid_identifier '=' const_expr
       {
-          $$ = new EnumValue($1 /* name */, $3 /* value */, convertYYLoc(@$));
+          $$ = ast->getArena().make<EnumValue>($1 /* name */, $3 /* value */, convertYYLoc(@$));
       }
     ;
 
@@ -1064,20 +1072,20 @@ array_type_base
     | TEMPLATED '<' type '>'
       {
           $1->setElementType(*$3);
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>($1, convertYYLoc(@1));
       }
     | TEMPLATED '<' TEMPLATED '<' type RSHIFT
       {
           $3->setElementType(*$5);
           $1->setElementType(Reference<Type>($3, convertYYLoc(@3)));
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>($1, convertYYLoc(@1));
       }
     ;
 
 array_type
     : array_type_base '[' const_expr ']'
       {
-          $$ = new ArrayType(*$1, $3, *scope);
+          $$ = ast->getArena().make<ArrayType>(*$1, $3, *scope);
       }
     | array_type '[' const_expr ']'
       {
@@ -1088,11 +1096,11 @@ array_type
 
 type
     : array_type_base { $$ = $1; }
-    | array_type { $$ = new Reference<Type>($1, convertYYLoc(@1)); }
+    | array_type { $$ = ast->getArena().make<Reference<Type>>($1, convertYYLoc(@1)); }
     | INTERFACE
       {
           // "interface" is a synonym of android.hidl.base@1.0::IBase
-          $$ = new Reference<Type>(gIBaseFqName, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>(gIBaseFqName, convertYYLoc(@1));
       }
     ;
 
@@ -1100,7 +1108,7 @@ type_or_inplace_compound_declaration
     : type { $$ = $1; }
     | annotated_compound_declaration
       {
-          $$ = new Reference<Type>($1, convertYYLoc(@1));
+          $$ = ast->getArena().make<Reference<Type>>($1, convertYYLoc(@1));
       }
     ;
 
@@ -22,13 +22,22 @@
 
 namespace android {
 
+struct SourceFile;
+
 struct Hash {
     static const std::vector<uint8_t> kEmptyHash;
 
     // path to .hal file
     static const Hash &getHash(const std::string &path);
+    // same as getHash(file.path()), but the first call for a path hashes
+    // file instead of mapping it again. file must not have been scanned yet.
+    static const Hash& getHash(const SourceFile& file);
     static void clearHash(const std::string& path);
 
+    // hash of the current contents of the file at path, bypassing getHash's
+    // cache (and therefore unaffected by clearHash)
+    static std::vector<uint8_t> computeHash(const std::string& path);
+
     // returns matching hashes of interfaceName in path
     // path is something like hardware/interfaces/current.txt
     // interfaceName is something like android.hardware.foo@1.0::IFoo
@@ -43,9 +52,9 @@ struct Hash {
     const std::string &getPath() const;
 
 private:
-    Hash(const std::string &path);
+    Hash(const std::string& path, const std::vector<uint8_t>& hash);
 
-    static Hash& getMutableHash(const std::string& path);
+    static Hash& getMutableHash(const std::string& path, const SourceFile* file);
 
     const std::string mPath;
     std::vector<uint8_t> mHash;
@@ -17,18 +17,26 @@
 #include "AST.h"
 #include "Coordinator.h"
 #include "Scope.h"
+#include "ThreadPool.h"
+#include "TimeReport.h"
+#include "VectorType.h"
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 #include <algorithm>
 #include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <sstream>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -100,17 +108,26 @@ struct FileGenerator {
             return OK;
         }
 
-        Formatter out = coordinator->getFormatter(fqName, location, getFileName(fqName));
+        const std::string fileName = getFileName(fqName);
+        TimeReport::Phase phase("generate",
+                                TimeReport::isEnabled() ? fqName.string() + " " + fileName : "");
+
+        Formatter out = coordinator->getFormatter(fqName, location, fileName);
         if (!out.isValid()) {
             return UNKNOWN_ERROR;
         }
 
-        return mGenerationFunction(out, fqName, coordinator);
+        status_t err = mGenerationFunction(out, fqName, coordinator);
+        if (!out.close() && err == OK) {
+            fprintf(stderr, "ERROR: could not write output for %s.\n", fqName.string().c_str());
+            err = UNKNOWN_ERROR;
+        }
+        return err;
     }
 
     // Helper methods for filling out this struct
     static bool generateForTypes(const FQName& fqName) {
-        const auto names = fqName.names();
+        const auto& names = fqName.names();
         return names.size() > 0 && names[0] == "types";
     }
     static bool generateForInterfaces(const FQName& fqName) { return !generateForTypes(fqName); }
@@ -144,6 +161,8 @@ struct OutputHandler {
    private:
     status_t appendTargets(const FQName& fqName, const Coordinator* coordinator,
                            std::vector<FQName>* targets) const;
+    status_t generateInParallel(const std::vector<FQName>& targets,
+                                const Coordinator* coordinator) const;
     status_t appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
                                std::vector<std::string>* outputFiles) const;
 };
@@ -214,6 +233,12 @@ status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordi
     status_t err = appendTargets(fqName, coordinator, &targets);
     if (err != OK) return err;
 
+    // Standard out is shared, and its output must stay in order.
+    if (coordinator->getJobs() > 1 && mLocation != Coordinator::Location::STANDARD_OUT &&
+        targets.size() * mGenerateFunctions.size() > 1) {
+        return generateInParallel(targets, coordinator);
+    }
+
     for (const FQName& fqName : targets) {
         for (const FileGenerator& file : mGenerateFunctions) {
             status_t err = file.generate(fqName, coordinator, mLocation);
@@ -224,6 +249,47 @@ status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordi
     return OK;
 }
 
+status_t OutputHandler::generateInParallel(const std::vector<FQName>& targets,
+                                           const Coordinator* coordinator) const {
+    // Parse, and so enforce restrictions, in the same order as generating
+    // serially would, so that nothing but code generation runs concurrently.
+    for (const FQName& fqName : targets) {
+        bool needed = false;
+        for (const FileGenerator& file : mGenerateFunctions) {
+            needed |= file.mShouldGenerateForFqName(fqName);
+        }
+        if (!needed || !fqName.isFullyQualified()) continue;
+
+        // PER_TYPE targets like types.Foo are generated from types.hal.
+        const FQName parsed = StringHelper::StartsWith(fqName.name(), "types.")
+                                  ? fqName.getTypesForPackage()
+                                  : fqName;
+        if (coordinator->parse(parsed) == nullptr) {
+            fprintf(stderr, "ERROR: Could not parse %s. Aborting.\n", parsed.string().c_str());
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    std::mutex mutex;
+    status_t result = OK;
+
+    ThreadPool pool(coordinator->getJobs());
+    for (const FQName& fqName : targets) {
+        for (const FileGenerator& file : mGenerateFunctions) {
+            pool.enqueue([&, fqName] {
+                status_t err = file.generate(fqName, coordinator, mLocation);
+                if (err != OK) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (result == OK) result = err;
+                }
+            });
+        }
+    }
+    pool.wait();
+
+    return result;
+}
+
 status_t OutputHandler::appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
                                           std::vector<std::string>* outputFiles) const {
     std::vector<FQName> targets;
@@ -348,6 +414,7 @@ static status_t isPackageJavaCompatible(const FQName& packageFQName, const Coord
     if (err != OK) {
         return err;
     }
+    coordinator->prefetch(todo);
 
     std::set<FQName> seen;
     for (const auto &iface : todo) {
@@ -382,6 +449,7 @@ static status_t isPackageJavaCompatible(const FQName& packageFQName, const Coord
             if (err != OK) {
                 return err;
             }
+            coordinator->prefetch(packageInterfaces);
 
             for (const auto &iface : packageInterfaces) {
                 if (seen.find(iface) != seen.end()) {
@@ -546,6 +614,7 @@ static status_t generateAndroidBpForPackage(Formatter& out, const FQName& packag
     if (err != OK) {
         return err;
     }
+    coordinator->prefetch(packageInterfaces);
 
     std::set<FQName> importedPackagesHierarchy;
     std::vector<const Type *> exportedTypes;
@@ -663,6 +732,7 @@ static status_t generateAndroidBpImplForPackage(Formatter& out, const FQName& pa
     if (err != OK) {
         return err;
     }
+    coordinator->prefetch(packageInterfaces);
 
     std::set<FQName> importedPackages;
 
@@ -800,6 +870,7 @@ FileGenerator::GenerationFunction generateExportHeaderForPackage(bool forJava) {
         if (err != OK) {
             return err;
         }
+        coordinator->prefetch(packageInterfaces);
 
         std::vector<const Type *> exportedTypes;
 
@@ -1088,6 +1159,23 @@ static const std::vector<OutputHandler> kFormats = {
         validateIsPackage,
         {singleFileGenerator("main.cpp", generateAdapterMainSource)},
     },
+    {
+        "c++-bench",
+        "Generates a Google Benchmark source timing the marshalling of every method.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::DIRECT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        {
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) {
+                    return fqName.getInterfaceBaseName() + "Benchmark.cpp";
+                },
+                astGenerationFunction(&AST::generateCppBenchSource),
+            },
+        },
+    },
     {
         "java",
         "(internal) Generates Java library for talking to HIDL interfaces in Java.",
@@ -1131,6 +1219,30 @@ static const std::vector<OutputHandler> kFormats = {
             },
         }
     },
+    {
+        "marshal-cost",
+        "Estimates what marshalling the arguments and results of every method costs.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::DIRECT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        {
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) {
+                    return fqName.getInterfaceBaseName() + "MarshalCost.json";
+                },
+                astGenerationFunction(&AST::generateMarshalCostJson),
+            },
+            {
+                FileGenerator::generateForInterfaces,
+                [](const FQName& fqName) {
+                    return fqName.getInterfaceBaseName() + "MarshalCost.txt";
+                },
+                astGenerationFunction(&AST::generateMarshalCostTable),
+            },
+        },
+    },
     {
         "makefile",
         "(removed) Used to generate makefiles for -Ljava and -Ljava-constants.",
@@ -1179,10 +1291,146 @@ static const std::vector<OutputHandler> kFormats = {
 };
 // clang-format on
 
+// Applies the -o rules of outputFormat to outputPath and sets it on the coordinator.
+static bool setOutputPath(const OutputHandler* outputFormat, std::string outputPath,
+                          Coordinator* coordinator) {
+    switch (outputFormat->mOutputMode) {
+        case OutputMode::NEEDS_DIR:
+        case OutputMode::NEEDS_FILE: {
+            if (outputPath.empty()) {
+                return false;
+            }
+
+            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
+                if (outputPath.back() != '/') {
+                    outputPath += "/";
+                }
+            }
+            break;
+        }
+        case OutputMode::NEEDS_SRC: {
+            if (outputPath.empty()) {
+                outputPath = coordinator->getRootPath();
+            }
+            if (outputPath.back() != '/') {
+                outputPath += "/";
+            }
+
+            break;
+        }
+
+        default:
+            outputPath.clear();  // Unused.
+            break;
+    }
+
+    coordinator->setOutputPath(outputPath);
+    return true;
+}
+
+static void addDefaultPackagePaths(Coordinator* coordinator) {
+    coordinator->addDefaultPackagePath("android.hardware", "hardware/interfaces");
+    coordinator->addDefaultPackagePath("android.hidl", "system/libhidl/transport");
+    coordinator->addDefaultPackagePath("android.frameworks", "frameworks/hardware/interfaces");
+    coordinator->addDefaultPackagePath("android.system", "system/hardware/interfaces");
+}
+
+static status_t generateForFqName(const OutputHandler* outputFormat, const std::string& name,
+                                  Coordinator* coordinator) {
+    FQName fqName;
+    if (!FQName::parse(name, &fqName)) {
+        fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", name.c_str());
+        return BAD_VALUE;
+    }
+
+    // Dump extra verbose output
+    if (coordinator->isVerbose()) {
+        status_t err =
+            dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), coordinator);
+        if (err != OK) return err;
+    }
+
+    if (!outputFormat->validate(fqName, coordinator, outputFormat->name())) {
+        fprintf(stderr,
+                "ERROR: output handler failed.\n");
+        return UNKNOWN_ERROR;
+    }
+
+    TimeReport::Phase phase("target", "-L" + outputFormat->name() + " " + name);
+
+    status_t err = outputFormat->generate(fqName, coordinator);
+    if (err != OK) return err;
+
+    return outputFormat->writeDepFile(fqName, coordinator);
+}
+
+// One line of a -B manifest. All jobs share a Coordinator, so each package is
+// parsed and checked at most once no matter how many jobs use it.
+struct BatchJob {
+    const OutputHandler* outputFormat;
+    std::string outputPath;
+    std::vector<std::string> fqNames;
+};
+
+static bool readBatchManifest(const std::string& path, std::vector<BatchJob>* jobs) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            fprintf(stderr, "ERROR: could not open manifest %s.\n", path.c_str());
+            return false;
+        }
+    }
+    std::istream& stream = path == "-" ? std::cin : file;
+
+    std::string line;
+    for (size_t lineNumber = 1; std::getline(stream, line); lineNumber++) {
+        std::istringstream words(line.substr(0, line.find('#')));
+
+        std::string language;
+        if (!(words >> language)) continue;  // blank or comment
+
+        BatchJob job;
+        job.outputFormat = nullptr;
+        for (auto& e : kFormats) {
+            if (e.name() == language) {
+                job.outputFormat = &e;
+                break;
+            }
+        }
+        if (job.outputFormat == nullptr) {
+            fprintf(stderr, "ERROR: unrecognized language \"%s\" at %s:%zu.\n", language.c_str(),
+                    path.c_str(), lineNumber);
+            return false;
+        }
+
+        if (!(words >> job.outputPath)) {
+            fprintf(stderr, "ERROR: missing output path at %s:%zu.\n", path.c_str(), lineNumber);
+            return false;
+        }
+        if (job.outputPath == "-") job.outputPath.clear();
+
+        std::string fqName;
+        while (words >> fqName) job.fqNames.push_back(fqName);
+        if (job.fqNames.empty()) {
+            fprintf(stderr, "ERROR: no fqname specified at %s:%zu.\n", path.c_str(), lineNumber);
+            return false;
+        }
+
+        jobs->push_back(std::move(job));
+    }
+
+    return true;
+}
+
 static void usage(const char *me) {
     fprintf(stderr,
             "usage: %s [-p <root path>] -o <output path> -L <language> [-O <owner>] (-r <interface "
-            "root>)+ [-v] [-d <depfile>] FQNAME...\n\n",
+            "root>)+ [-v] [-d <depfile>] [-C <cache dir>] [-j <jobs>] [-u] FQNAME...\n",
+            me);
+    fprintf(stderr,
+            "       %s [-p <root path>] (-r <interface root>)+ [-v] [-C <cache dir>] [-j <jobs>] "
+            "[-u] -B <manifest>\n\n",
             me);
 
     fprintf(stderr,
@@ -1199,8 +1447,31 @@ static void usage(const char *me) {
     fprintf(stderr, "         -r <package:path root>: E.g., android.hardware:hardware/interfaces.\n");
     fprintf(stderr, "         -v: verbose output.\n");
     fprintf(stderr, "         -d <depfile>: location of depfile to write to.\n");
+    fprintf(stderr, "         -C <cache dir>: location to persist parsed files and package checks across runs.\n");
+    fprintf(stderr, "         -j <jobs>: number of threads parsing and generating, defaults to 1.\n");
+    fprintf(stderr, "         -u: only replace output files whose content changed.\n");
+    fprintf(stderr, "         -B <manifest>: run every job in manifest (- for stdin), one per line:\n");
+    fprintf(stderr, "            <language> <output path, or - for none> FQNAME...\n");
+    fprintf(stderr, "         --time-report <file>: write time and calls per phase, and peak RSS, as JSON.\n");
+    fprintf(stderr, "         --time-trace <file>: write every phase as a Chrome trace.\n");
+    fprintf(stderr, "         --java-primitive-vectors: -Ljava uses int[], byte[], ... for\n");
+    fprintf(stderr, "            vec<scalar> instead of ArrayList<Integer>, ... (changes the API).\n");
 }
 
+// Long options, which have no single letter form.
+enum {
+    kTimeReportOption = 256,
+    kTimeTraceOption,
+    kJavaPrimitiveVectorsOption,
+};
+
+static const struct option kLongOptions[] = {
+    {"time-report", required_argument, nullptr, kTimeReportOption},
+    {"time-trace", required_argument, nullptr, kTimeTraceOption},
+    {"java-primitive-vectors", no_argument, nullptr, kJavaPrimitiveVectorsOption},
+    {nullptr, 0, nullptr, 0},
+};
+
 // hidl is intentionally leaky. Turn off LeakSanitizer by default.
 extern "C" const char *__asan_default_options() {
     return "detect_leaks=0";
@@ -1216,9 +1487,14 @@ int main(int argc, char **argv) {
     const OutputHandler* outputFormat = nullptr;
     Coordinator coordinator;
     std::string outputPath;
+    std::string batchManifest;
+    bool hasDepFile = false;
+    size_t jobs = 1;
+    std::string timeReportPath;
+    std::string timeTracePath;
 
     int res;
-    while ((res = getopt(argc, argv, "hp:o:O:r:L:vd:")) >= 0) {
+    while ((res = getopt_long(argc, argv, "hp:o:O:r:L:vd:C:B:j:u", kLongOptions, nullptr)) >= 0) {
         switch (res) {
             case 'p': {
                 if (!coordinator.getRootPath().empty()) {
@@ -1236,6 +1512,34 @@ int main(int argc, char **argv) {
 
             case 'd': {
                 coordinator.setDepFile(optarg);
+                hasDepFile = true;
+                break;
+            }
+
+            case 'B': {
+                if (!batchManifest.empty()) {
+                    fprintf(stderr, "ERROR: -B <manifest> can only be specified once.\n");
+                    exit(1);
+                }
+                batchManifest = optarg;
+                break;
+            }
+
+            case 'C': {
+                coordinator.setCacheDir(optarg);
+                break;
+            }
+
+            case 'u': {
+                coordinator.setWriteOnlyIfChanged(true);
+                break;
+            }
+
+            case 'j': {
+                if (!base::ParseUint(optarg, &jobs) || jobs == 0) {
+                    fprintf(stderr, "ERROR: -j <jobs> must be a positive number: %s\n", optarg);
+                    exit(1);
+                }
                 break;
             }
 
@@ -1300,6 +1604,21 @@ int main(int argc, char **argv) {
                 break;
             }
 
+            case kTimeReportOption: {
+                timeReportPath = optarg;
+                break;
+            }
+
+            case kTimeTraceOption: {
+                timeTracePath = optarg;
+                break;
+            }
+
+            case kJavaPrimitiveVectorsOption: {
+                VectorType::setJavaPrimitiveVectors(true);
+                break;
+            }
+
             case '?':
             case 'h':
             default: {
@@ -1317,87 +1636,81 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (outputFormat == nullptr) {
-        fprintf(stderr,
-            "ERROR: no -L option provided.\n");
-        exit(1);
-    }
+    coordinator.setJobs(jobs);
 
     argc -= optind;
     argv += optind;
 
-    if (argc == 0) {
-        fprintf(stderr, "ERROR: no fqname specified.\n");
-        usage(me);
-        exit(1);
+    if (!timeReportPath.empty() || !timeTracePath.empty()) {
+        TimeReport::enable();
     }
 
-    // Valid options are now in argv[0] .. argv[argc - 1].
+    // Reports are written even if generation fails.
+    const auto finish = [&](int exitCode) {
+        if (!timeReportPath.empty() && TimeReport::writeReport(timeReportPath) != OK) return 1;
+        if (!timeTracePath.empty() && TimeReport::writeTrace(timeTracePath) != OK) return 1;
+        return exitCode;
+    };
 
-    switch (outputFormat->mOutputMode) {
-        case OutputMode::NEEDS_DIR:
-        case OutputMode::NEEDS_FILE: {
-            if (outputPath.empty()) {
-                usage(me);
-                exit(1);
+    if (!batchManifest.empty()) {
+        if (outputFormat != nullptr || !outputPath.empty() || argc != 0) {
+            fprintf(stderr, "ERROR: -B <manifest> cannot be combined with -L, -o or FQNAME.\n");
+            exit(1);
+        }
+        if (hasDepFile) {
+            fprintf(stderr, "ERROR: -B <manifest> cannot be combined with -d <depfile>.\n");
+            exit(1);
+        }
+
+        std::vector<BatchJob> batchJobs;
+        if (!readBatchManifest(batchManifest, &batchJobs)) exit(1);
+
+        addDefaultPackagePaths(&coordinator);
+
+        // From here on, return rather than exit, so that the coordinator
+        // stops its worker threads before static data is destroyed.
+        for (const BatchJob& job : batchJobs) {
+            if (!setOutputPath(job.outputFormat, job.outputPath, &coordinator)) {
+                fprintf(stderr, "ERROR: invalid output path '%s' for -L%s in %s.\n",
+                        job.outputPath.c_str(), job.outputFormat->name().c_str(),
+                        batchManifest.c_str());
+                return finish(1);
             }
 
-            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
-                if (outputPath.back() != '/') {
-                    outputPath += "/";
+            for (const std::string& fqName : job.fqNames) {
+                if (generateForFqName(job.outputFormat, fqName, &coordinator) != OK) {
+                    return finish(1);
                 }
             }
-            break;
-        }
-        case OutputMode::NEEDS_SRC: {
-            if (outputPath.empty()) {
-                outputPath = coordinator.getRootPath();
-            }
-            if (outputPath.back() != '/') {
-                outputPath += "/";
-            }
-
-            break;
         }
 
-        default:
-            outputPath.clear();  // Unused.
-            break;
+        return finish(0);
     }
 
-    coordinator.setOutputPath(outputPath);
-
-    coordinator.addDefaultPackagePath("android.hardware", "hardware/interfaces");
-    coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
-    coordinator.addDefaultPackagePath("android.frameworks", "frameworks/hardware/interfaces");
-    coordinator.addDefaultPackagePath("android.system", "system/hardware/interfaces");
+    if (outputFormat == nullptr) {
+        fprintf(stderr,
+            "ERROR: no -L option provided.\n");
+        exit(1);
+    }
 
-    for (int i = 0; i < argc; ++i) {
-        FQName fqName;
-        if (!FQName::parse(argv[i], &fqName)) {
-            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", argv[i]);
-            exit(1);
-        }
+    if (argc == 0) {
+        fprintf(stderr, "ERROR: no fqname specified.\n");
+        usage(me);
+        exit(1);
+    }
 
-        // Dump extra verbose output
-        if (coordinator.isVerbose()) {
-            status_t err =
-                dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), &coordinator);
-            if (err != OK) return err;
-        }
+    // Valid options are now in argv[0] .. argv[argc - 1].
 
-        if (!outputFormat->validate(fqName, &coordinator, outputFormat->name())) {
-            fprintf(stderr,
-                    "ERROR: output handler failed.\n");
-            exit(1);
-        }
+    if (!setOutputPath(outputFormat, outputPath, &coordinator)) {
+        usage(me);
+        exit(1);
+    }
 
-        status_t err = outputFormat->generate(fqName, &coordinator);
-        if (err != OK) exit(1);
+    addDefaultPackagePaths(&coordinator);
 
-        err = outputFormat->writeDepFile(fqName, &coordinator);
-        if (err != OK) exit(1);
+    for (int i = 0; i < argc; ++i) {
+        if (generateForFqName(outputFormat, argv[i], &coordinator) != OK) return finish(1);
     }
 
-    return 0;
+    return finish(0);
 }
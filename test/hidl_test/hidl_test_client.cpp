@@ -524,6 +524,70 @@ TEST_F(HidlTest, EnumToStringTest) {
     EXPECT_EQ(toString(Grandchild::B), "B"s);
 }
 
+// Every value of T parses back from the name toString gives it.
+template <typename T>
+static void expectFromStringRoundTrips() {
+    for (const auto value : hidl_enum_iterator<T>()) {
+        T parsed{};
+        EXPECT_TRUE(fromString(toString(value), &parsed)) << toString(value);
+        EXPECT_EQ(value, parsed) << toString(value);
+    }
+}
+
+TEST_F(HidlTest, EnumFromStringTest) {
+    using ::android::hardware::tests::foo::V1_0::fromString;
+    using ::android::hardware::tests::foo::V1_0::toString;
+    using Empty = ::android::hardware::tests::foo::V1_0::EnumIterators::Empty;
+    using Grandchild = ::android::hardware::tests::foo::V1_0::EnumIterators::Grandchild;
+    using SkipsValues = ::android::hardware::tests::foo::V1_0::EnumIterators::SkipsValues;
+    using MultipleValues = ::android::hardware::tests::foo::V1_0::EnumIterators::MultipleValues;
+
+    expectFromStringRoundTrips<IFoo::BitField>();
+    expectFromStringRoundTrips<Grandchild>();
+    expectFromStringRoundTrips<SkipsValues>();
+    expectFromStringRoundTrips<MultipleValues>();
+
+    // values inherited from a parent enum
+    Grandchild grandchild = Grandchild::B;
+    EXPECT_TRUE(fromString("A", &grandchild));
+    EXPECT_EQ(Grandchild::A, grandchild);
+    EXPECT_TRUE(fromString("B", &grandchild));
+    EXPECT_EQ(Grandchild::B, grandchild);
+
+    // Some names of MultipleValues share a value. Each name parses to its own
+    // value, and toString gives the first name declared for that value.
+    const std::vector<std::pair<std::string, MultipleValues>> names = {
+        {"A", MultipleValues::A},
+        {"B", MultipleValues::B},
+        {"C", MultipleValues::C},
+        {"D", MultipleValues::D},
+    };
+    for (const auto& name : names) {
+        MultipleValues parsed = MultipleValues::A;
+        EXPECT_TRUE(fromString(name.first, &parsed)) << name.first;
+        EXPECT_EQ(name.second, parsed) << name.first;
+
+        const auto first = std::find_if(names.begin(), names.end(), [&](const auto& other) {
+            return other.second == name.second;
+        });
+        EXPECT_EQ(first->first, toString(name.second)) << name.first;
+    }
+
+    // unknown names leave the output alone
+    for (const std::string& unknown : {"", "a", "AB", "V0 ", "NOT_A_VALUE"}) {
+        MultipleValues unchanged = MultipleValues::C;
+        EXPECT_FALSE(fromString(unknown, &unchanged)) << unknown;
+        EXPECT_EQ(MultipleValues::C, unchanged) << unknown;
+
+        IFoo::BitField bitField = IFoo::BitField::V1;
+        EXPECT_FALSE(fromString(unknown, &bitField)) << unknown;
+        EXPECT_EQ(IFoo::BitField::V1, bitField) << unknown;
+    }
+    Empty empty = static_cast<Empty>(7);
+    EXPECT_FALSE(fromString("A", &empty));
+    EXPECT_EQ(static_cast<Empty>(7), empty);
+}
+
 TEST_F(HidlTest, PingTest) {
     EXPECT_OK(manager->ping());
 }
@@ -1697,6 +1761,66 @@ TEST_F(HidlTest, StructEqualTest) {
     EXPECT_TRUE(g1 != g3);
 }
 
+TEST_F(HidlTest, StructHashTest) {
+    using G = IFoo::Goober;
+    using F = IFoo::Fumble;
+    // byte-comparable: compared with memcmp and hashed word by word
+    using Inner = decltype(F::data);
+
+    auto expectSameHash = [](const auto& a, const auto& b) {
+        using T = std::decay_t<decltype(a)>;
+        EXPECT_TRUE(a == b);
+        EXPECT_EQ(std::hash<T>()(a), std::hash<T>()(b));
+    };
+
+    std::unordered_set<Inner> set{Inner{.data = 50}, Inner{.data = 60}, Inner{.data = 50}};
+    EXPECT_EQ(2u, set.size());
+    EXPECT_EQ(1u, set.count(Inner{.data = 50}));
+    EXPECT_EQ(1u, set.count(Inner{.data = 60}));
+    EXPECT_EQ(0u, set.count(Inner{.data = 70}));
+
+    const std::vector<int32_t> values{0, 1, -1, 50, INT32_MIN, INT32_MAX};
+    for (int32_t lhs : values) {
+        for (int32_t rhs : values) {
+            EXPECT_EQ(lhs == rhs, Inner{.data = lhs} == Inner{.data = rhs});
+            EXPECT_EQ(lhs != rhs, Inner{.data = lhs} != Inner{.data = rhs});
+        }
+        expectSameHash(Inner{.data = lhs}, Inner{.data = lhs});
+    }
+
+    // nested
+    expectSameHash(F{.data = {.data = 50}}, F{.data = {.data = 50}});
+
+    // floating point and strings; 0.0 == -0.0 must hash equally
+    G g1{
+        .q = 42,
+        .name = "The Ultimate Question of Life, the Universe, and Everything",
+        .address = "North Pole",
+        .numbers = std::array<double, 10>{ {0.0, 2, 3, 4, 5, 6, 7, 8, 9, 10} },
+        .fumble = F{.data = {.data = 50}},
+        .gumble = F{.data = {.data = 60}}
+    };
+    G g2{
+        .q = 42,
+        .name = std::string("The Ultimate Question of Life, the Universe, and Everything"),
+        .address = std::string("North Pole"),
+        .numbers = std::array<double, 10>{ {-0.0, 2, 3, 4, 5, 6, 7, 8, 9, 10} },
+        .fumble = F{.data = {.data = 50}},
+        .gumble = F{.data = {.data = 60}}
+    };
+    expectSameHash(g1, g2);
+
+    // vectors
+    TrieNode trie1, trie2;
+    trieInterface->newTrie([&](const TrieNode& trie) {
+        trieInterface->addStrings(trie, {"a", "ba"}, [&](const TrieNode& trie) { trie1 = trie; });
+    });
+    trieInterface->newTrie([&](const TrieNode& trie) {
+        trieInterface->addStrings(trie, {"a", "ba"}, [&](const TrieNode& trie) { trie2 = trie; });
+    });
+    expectSameHash(trie1, trie2);
+}
+
 TEST_F(HidlTest, EnumEqualTest) {
     using E = IFoo::SomeEnum;
     E e1 = E::quux;
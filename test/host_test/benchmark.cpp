@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <AST.h>
+#include <Coordinator.h>
+#include <hidl-gen_l.h>
+#include <hidl-hash/Hash.h>
+#include <hidl-util/Formatter.h>
+#include <hidl-util/SourceFile.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+using ::android::AST;
+using ::android::Coordinator;
+using ::android::Formatter;
+using ::android::Hash;
+using ::android::OK;
+using ::android::SourceFile;
+
+// A types.hal defining kTypes structs, enums and typedefs, which reference
+// each other and use constant expressions, as real packages do.
+static std::string writeSyntheticPackage(size_t kTypes) {
+    char dir[] = "/tmp/hidl-gen-host_benchmark-XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        return "";
+    }
+
+    const std::string path = std::string(dir) + "/types.hal";
+    std::ofstream out(path);
+    out << "package a.b@1.0;\n\n";
+    for (size_t i = 0; i < kTypes; i += 4) {
+        const std::string n = std::to_string(i);
+        out << "enum E" << n << " : uint32_t {\n"
+            << "    A = " << n << ",\n"
+            << "    B = A + 1,\n"
+            << "    C = (B << 2) | A,\n"
+            << "};\n\n";
+        out << "typedef E" << n << " T" << n << ";\n\n";
+        out << "struct S" << n << " {\n"
+            << "    T" << n << " e;\n"
+            << "    uint8_t[E" << n << ":B - E" << n << ":A + 1] data;\n"
+            << "    vec<string> names;\n";
+        if (i > 0) {
+            out << "    S" << i - 4 << " previous;\n";
+        }
+        out << "};\n\n";
+        out << "union U" << n << " {\n"
+            << "    uint32_t value;\n"
+            << "    E" << n << " tag;\n"
+            << "};\n\n";
+    }
+    return path;
+}
+
+static void BM_PostParse(benchmark::State& state) {
+    const std::string path = writeSyntheticPackage(state.range(0));
+    if (SourceFile::open(path) == nullptr) {
+        state.SkipWithError("Cannot write synthetic package");
+        return;
+    }
+
+    Coordinator coordinator;
+    for (auto _ : state) {
+        state.PauseTiming();
+        // The lexer writes into the mapping it scans, so each parse maps its own.
+        std::unique_ptr<SourceFile> file = SourceFile::open(path);
+        std::unique_ptr<AST> ast = std::make_unique<AST>(&coordinator, &Hash::getHash(path));
+        if (file == nullptr || parseFile(ast.get(), file.get()) != OK) {
+            state.SkipWithError("Cannot parse synthetic package");
+            break;
+        }
+        state.ResumeTiming();
+
+        if (ast->postParse() != OK) {
+            state.SkipWithError("postParse failed");
+            break;
+        }
+
+        state.PauseTiming();
+        ast.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    unlink(path.c_str());
+    rmdir(path.substr(0, path.rfind('/')).c_str());
+}
+BENCHMARK(BM_PostParse)->Arg(100)->Arg(1000);
+
+// An IFoo.hal with kMethods methods passing nested structs, vectors and
+// arrays around, so that code generation spells the same C++ types over and
+// over.
+static std::string writeSyntheticInterface(size_t kMethods) {
+    char dir[] = "/tmp/hidl-gen-host_benchmark-XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        return "";
+    }
+
+    const std::string path = std::string(dir) + "/IFoo.hal";
+    std::ofstream out(path);
+    out << "package a.b@1.0;\n\n"
+        << "interface IFoo {\n"
+        << "    enum Kind : uint32_t { A, B, C };\n\n"
+        << "    struct Inner {\n"
+        << "        Kind kind;\n"
+        << "        vec<string> names;\n"
+        << "        uint8_t[16] id;\n"
+        << "    };\n\n"
+        << "    struct Outer {\n"
+        << "        Inner inner;\n"
+        << "        vec<Inner> inners;\n"
+        << "        Inner[2][3] grid;\n"
+        << "        handle h;\n"
+        << "    };\n\n";
+    for (size_t i = 0; i < kMethods; ++i) {
+        const std::string n = std::to_string(i);
+        out << "    method" << n << "(Outer outer, vec<Outer> outers, Kind kind)\n"
+            << "        generates (vec<Inner> inners, Outer outer, string name);\n";
+    }
+    out << "};\n";
+    return path;
+}
+
+// Google Benchmark calls a benchmark function several times for each
+// argument, so a single Coordinator, which parses IBase once, and the parsed
+// interfaces are kept for the whole run. Returns nullptr if the interface
+// cannot be parsed. Needs $ANDROID_BUILD_TOP to find android.hidl.base.
+static const AST* parseSyntheticInterface(size_t kMethods) {
+    static Coordinator coordinator;
+    static std::map<size_t, std::unique_ptr<AST>> asts;
+
+    auto it = asts.find(kMethods);
+    if (it != asts.end()) {
+        return it->second.get();
+    }
+
+    if (coordinator.getRootPath().empty()) {
+        const char* ANDROID_BUILD_TOP = getenv("ANDROID_BUILD_TOP");
+        if (ANDROID_BUILD_TOP == nullptr) {
+            return nullptr;
+        }
+        coordinator.setRootPath(ANDROID_BUILD_TOP);
+        coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
+    }
+
+    const std::string path = writeSyntheticInterface(kMethods);
+    std::unique_ptr<SourceFile> file = SourceFile::open(path);
+    std::unique_ptr<AST> ast = std::make_unique<AST>(&coordinator, &Hash::getHash(path));
+    if (file == nullptr || parseFile(ast.get(), file.get()) != OK || ast->postParse() != OK) {
+        ast.reset();
+    }
+
+    unlink(path.c_str());
+    rmdir(path.substr(0, path.rfind('/')).c_str());
+
+    return asts.emplace(kMethods, std::move(ast)).first->second.get();
+}
+
+static void BM_GenerateCppSources(benchmark::State& state) {
+    const AST* ast = parseSyntheticInterface(state.range(0));
+    if (ast == nullptr) {
+        state.SkipWithError("Cannot parse synthetic interface, is $ANDROID_BUILD_TOP set?");
+        return;
+    }
+
+    for (auto _ : state) {
+        Formatter out = Formatter::inMemory();
+        ast->generateCppSource(out);
+        benchmark::DoNotOptimize(out.getOutput());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GenerateCppSources)->Arg(10)->Arg(100);
+
+BENCHMARK_MAIN();
@@ -18,9 +18,22 @@
 
 #include <gtest/gtest.h>
 
+#include <AST.h>
 #include <ConstantExpression.h>
 #include <Coordinator.h>
+#include <hidl-gen_l.h>
+#include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
+#include <hidl-util/Formatter.h>
+
+#include <ftw.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
 
 #define EXPECT_EQ_OK(expectResult, call, ...)        \
     do {                                             \
@@ -105,6 +118,290 @@ TEST_F(HidlGenHostTest, LocationTest) {
     EXPECT_FALSE(Location::inSameFile(a, other));
 }
 
+static std::string parseAndGenerateHeader(const Coordinator& coordinator,
+                                          const std::string& path) {
+    std::unique_ptr<SourceFile> file = SourceFile::open(path);
+    if (file == nullptr) {
+        return "";
+    }
+
+    AST ast(&coordinator, &Hash::getHash(*file));
+    if (parseFile(&ast, file.get()) != OK || ast.postParse() != OK) {
+        return "";
+    }
+
+    Formatter out = Formatter::inMemory();
+    ast.generateInterfaceHeader(out);
+    return out.getOutput();
+}
+
+TEST_F(HidlGenHostTest, ConcurrentParseTest) {
+    constexpr size_t kFiles = 64;
+    constexpr size_t kThreads = 8;
+
+    char dir[] = "/tmp/hidl-gen-host_test-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+
+    // Every file has its own doc comments, so any scanner state shared
+    // between parses shows up in the generated headers.
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < kFiles; ++i) {
+        const std::string n = std::to_string(i);
+        paths.push_back(std::string(dir) + "/types" + n + ".hal");
+        std::ofstream(paths.back()) << "package a.b@1.0;\n\n"
+                                    << "/**\n * Struct number " << n << ".\n */\n"
+                                    << "struct S" << n << " {\n"
+                                    << "    vec<string> names;\n"
+                                    << "    uint32_t value;\n"
+                                    << "};\n\n"
+                                    << "/** Enum number " << n << ". */\n"
+                                    << "enum E" << n << " : uint8_t {\n"
+                                    << "    A = " << n << ",\n"
+                                    << "    B = A + 1,\n"
+                                    << "};\n";
+    }
+
+    Coordinator coordinator;
+
+    std::vector<std::string> serial;
+    for (const std::string& path : paths) {
+        serial.push_back(parseAndGenerateHeader(coordinator, path));
+        EXPECT_NE("", serial.back()) << path;
+    }
+
+    std::vector<std::string> concurrent(kFiles);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < kFiles; i += kThreads) {
+                concurrent[i] = parseAndGenerateHeader(coordinator, paths[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < kFiles; ++i) {
+        EXPECT_EQ(serial[i], concurrent[i]) << paths[i];
+        unlink(paths[i].c_str());
+    }
+    rmdir(dir);
+}
+
+// Parses fqName with a fresh Coordinator, returning its header and source and
+// whether it was loaded from the AST cache.
+static std::string generateWithCache(const std::string& root, const std::string& cacheDir,
+                                     const FQName& fqName, bool* cached) {
+    Coordinator coordinator;
+    coordinator.addPackagePath("a", root, nullptr /* error */);
+    coordinator.setCacheDir(cacheDir);
+    coordinator.setVerbose(true);
+
+    const char* ANDROID_BUILD_TOP = getenv("ANDROID_BUILD_TOP");
+    if (ANDROID_BUILD_TOP != nullptr) {
+        coordinator.setRootPath(ANDROID_BUILD_TOP);
+        coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
+    }
+
+    ::testing::internal::CaptureStderr();
+    AST* ast = coordinator.parse(fqName, nullptr /* parsedASTs */, Coordinator::Enforce::NONE);
+    const std::string log = ::testing::internal::GetCapturedStderr();
+    *cached = log.find("VERBOSE: using cached AST " + cacheDir + "/ast/" + fqName.string() +
+                       "\n") != std::string::npos;
+    if (ast == nullptr) {
+        return "";
+    }
+
+    Formatter out = Formatter::inMemory();
+    ast->generateInterfaceHeader(out);
+    ast->generateCppSource(out);
+    return out.getOutput();
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+
+TEST_F(HidlGenHostTest, ASTCacheTest) {
+    char dir[] = "/tmp/hidl-gen-host_test-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    const std::string root = std::string(dir) + "/a";
+    const std::string cacheDir = std::string(dir) + "/cache";
+    for (const std::string& path :
+         {root, root + "/b", root + "/b/1.0", root + "/c", root + "/c/1.0"}) {
+        ASSERT_EQ(0, mkdir(path.c_str(), 0777)) << path;
+    }
+
+    // a.b refers to, and extends, types of another AST, which is cached too.
+    std::ofstream(root + "/c/1.0/types.hal") << "package a.c@1.0;\n\n"
+                                             << "enum Color : uint8_t {\n"
+                                             << "    RED = 1,\n"
+                                             << "    GREEN,\n"
+                                             << "};\n\n"
+                                             << "typedef int32_t[2] Pair;\n";
+    std::ofstream(root + "/b/1.0/types.hal") << "package a.b@1.0;\n\n"
+                                             << "import a.c@1.0;\n\n"
+                                             << "/** More colors. */\n"
+                                             << "enum MoreColor : Color {\n"
+                                             << "    BLUE,\n"
+                                             << "    PURPLE = BLUE | (1 << 5),\n"
+                                             << "};\n\n"
+                                             << "struct S {\n"
+                                             << "    struct Inner {\n"
+                                             << "        vec<MoreColor> colors;\n"
+                                             << "    };\n"
+                                             << "    Inner inner;\n"
+                                             << "    Pair[3] pairs;\n"
+                                             << "    bitfield<Color> mask;\n"
+                                             << "};\n";
+
+    const FQName kTypes("a.b@1.0::types");
+    bool cached;
+    const std::string parsed = generateWithCache(root, cacheDir, kTypes, &cached);
+    EXPECT_NE("", parsed);
+    EXPECT_FALSE(cached);
+
+    const std::string entry = cacheDir + "/ast/a.b@1.0::types";
+    std::string contents;
+    {
+        std::ifstream stream(entry);
+        contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    ASSERT_NE("", contents);
+
+    EXPECT_EQ(parsed, generateWithCache(root, cacheDir, kTypes, &cached));
+    EXPECT_TRUE(cached);
+
+    // A malformed entry is parsed again.
+    std::ofstream(entry) << contents.substr(0, contents.size() / 2);
+    EXPECT_EQ(parsed, generateWithCache(root, cacheDir, kTypes, &cached));
+    EXPECT_FALSE(cached);
+
+    // Entries are not used once the package root is found elsewhere.
+    const std::string movedRoot = std::string(dir) + "/moved";
+    ASSERT_EQ(0, rename(root.c_str(), movedRoot.c_str()));
+    EXPECT_EQ(parsed, generateWithCache(movedRoot, cacheDir, kTypes, &cached));
+    EXPECT_FALSE(cached);
+
+    nftw(dir, removeEntry, 16 /* nopenfd */, FTW_DEPTH | FTW_PHYS);
+}
+
+// Interfaces also restore the methods they get from IBase. Needs
+// $ANDROID_BUILD_TOP to find android.hidl.base.
+TEST_F(HidlGenHostTest, ASTCacheInterfaceTest) {
+    if (getenv("ANDROID_BUILD_TOP") == nullptr) {
+        std::cerr << "Skipping, $ANDROID_BUILD_TOP is not set." << std::endl;
+        return;
+    }
+
+    char dir[] = "/tmp/hidl-gen-host_test-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    const std::string root = std::string(dir) + "/a";
+    const std::string cacheDir = std::string(dir) + "/cache";
+    for (const std::string& path : {root, root + "/b", root + "/b/1.0"}) {
+        ASSERT_EQ(0, mkdir(path.c_str(), 0777)) << path;
+    }
+
+    std::ofstream(root + "/b/1.0/types.hal") << "package a.b@1.0;\n\n"
+                                             << "struct Point {\n"
+                                             << "    int32_t x;\n"
+                                             << "    int32_t y;\n"
+                                             << "};\n";
+    std::ofstream(root + "/b/1.0/IFoo.hal") << "package a.b@1.0;\n\n"
+                                            << "interface IFoo {\n"
+                                            << "    enum Mode : uint32_t {\n"
+                                            << "        FAST,\n"
+                                            << "        SLOW,\n"
+                                            << "    };\n\n"
+                                            << "    /** Moves to a point. */\n"
+                                            << "    moveTo(Point point, Mode mode) generates "
+                                            << "(bool ok);\n"
+                                            << "    oneway reset();\n"
+                                            << "    points() generates (vec<Point> points, "
+                                            << "handle fd);\n"
+                                            << "};\n";
+    std::ofstream(root + "/b/1.0/IBar.hal") << "package a.b@1.0;\n\n"
+                                            << "import IFoo;\n\n"
+                                            << "interface IBar extends IFoo {\n"
+                                            << "    foo() generates (IFoo foo);\n"
+                                            << "};\n";
+
+    for (const FQName& fqName : {FQName("a.b@1.0::IFoo"), FQName("a.b@1.0::IBar")}) {
+        bool cached;
+        const std::string parsed = generateWithCache(root, cacheDir, fqName, &cached);
+        EXPECT_NE("", parsed) << fqName.string();
+        EXPECT_FALSE(cached) << fqName.string();
+
+        EXPECT_EQ(parsed, generateWithCache(root, cacheDir, fqName, &cached)) << fqName.string();
+        EXPECT_TRUE(cached) << fqName.string();
+    }
+
+    nftw(dir, removeEntry, 16 /* nopenfd */, FTW_DEPTH | FTW_PHYS);
+}
+
+// Needs $ANDROID_BUILD_TOP to find android.hidl.base.
+TEST_F(HidlGenHostTest, MarshalCostTest) {
+    const char* ANDROID_BUILD_TOP = getenv("ANDROID_BUILD_TOP");
+    if (ANDROID_BUILD_TOP == nullptr) {
+        std::cerr << "Skipping, $ANDROID_BUILD_TOP is not set." << std::endl;
+        return;
+    }
+
+    char dir[] = "/tmp/hidl-gen-host_test-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    const std::string root = std::string(dir) + "/a";
+    for (const std::string& path : {root, root + "/b", root + "/b/1.0"}) {
+        ASSERT_EQ(0, mkdir(path.c_str(), 0777)) << path;
+    }
+
+    std::ofstream(root + "/b/1.0/IFoo.hal") << "package a.b@1.0;\n\n"
+                                            << "interface IFoo {\n"
+                                            << "    struct Node {\n"
+                                            << "        int32_t value;\n"
+                                            << "        vec<Node> children;\n"
+                                            << "    };\n\n"
+                                            << "    passHandle(handle h);\n"
+                                            << "    passInterfaces(vec<IFoo> foos) generates "
+                                            << "(IFoo foo);\n"
+                                            << "    passNested(vec<vec<uint8_t>> data);\n"
+                                            << "    passQueue(fmq_sync<uint8_t> queue);\n"
+                                            << "    passTree(Node root);\n"
+                                            << "};\n";
+
+    Coordinator coordinator;
+    coordinator.setRootPath(ANDROID_BUILD_TOP);
+    coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
+    coordinator.addPackagePath("a", root, nullptr /* error */);
+
+    AST* ast = coordinator.parse(FQName("a.b@1.0::IFoo"), nullptr /* parsedASTs */,
+                                 Coordinator::Enforce::NONE);
+    ASSERT_NE(nullptr, ast);
+
+    Formatter out = Formatter::inMemory();
+    ast->generateMarshalCostTable(out);
+
+    // A handle is one top-level buffer and a vector of interfaces has no
+    // buffers at all, as emitReaderWriter writes them.
+    EXPECT_EQ(
+        "a.b@1.0::IFoo\n"
+        "\n"
+        "method          dir  bytes  buffers  fds  binders  depth  resolve\n"
+        "passHandle      in      0+        1    1        0      1       no\n"
+        "passInterfaces  in      8+        0    0        1      0       no\n"
+        "passInterfaces  out      0        0    0        1      0       no\n"
+        "passNested      in     16+        3    0        0      3       no\n"
+        "passQueue       in     32+        3    1        0      2       no\n"
+        "passTree        in    24+*        2    0        0      2       no\n"
+        "\n"
+        "bytes: fixed bytes copied, '+' if there is a data dependent part on top,\n"
+        "       '*' if a recursive struct makes it unbounded.\n"
+        "depth: longest chain of buffers embedded in one another.\n",
+        out.getOutput());
+
+    nftw(dir, removeEntry, 16 /* nopenfd */, FTW_DEPTH | FTW_PHYS);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
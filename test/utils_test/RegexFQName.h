@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HIDL_GEN_UTILS_TEST_REGEX_FQNAME_H_
+#define HIDL_GEN_UTILS_TEST_REGEX_FQNAME_H_
+
+#include <regex>
+#include <string>
+#include <vector>
+
+// The std::regex based FQName grammar that FQName::setTo used to implement.
+// It is the reference for the hand-written parser, in tests and benchmarks.
+
+#define RE_COMPONENT    "[a-zA-Z_][a-zA-Z_0-9]*"
+#define RE_PATH         RE_COMPONENT "(?:[.]" RE_COMPONENT ")*"
+#define RE_MAJOR        "[0-9]+"
+#define RE_MINOR        "[0-9]+"
+
+struct RegexFQName {
+    bool valid = false;
+    bool isIdentifier = false;
+    std::string package;
+    std::string major;
+    std::string minor;
+    std::string name;
+    std::string valueName;
+};
+
+inline RegexFQName regexParseFQName(const std::string& s) {
+    static const std::regex kRE1("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
+    static const std::regex kRE2("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
+    static const std::regex kRE3("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")");
+    static const std::regex kRE4("(" RE_COMPONENT ")([.]" RE_COMPONENT ")+");
+    static const std::regex kRE5("(" RE_COMPONENT ")");
+    static const std::regex kRE6("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH
+                                 "):(" RE_COMPONENT ")");
+    static const std::regex kRE7("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH "):(" RE_COMPONENT
+                                 ")");
+    static const std::regex kRE8("(" RE_PATH "):(" RE_COMPONENT ")");
+
+    RegexFQName ret;
+    ret.valid = true;
+
+    std::smatch match;
+    if (std::regex_match(s, match, kRE1)) {
+        ret.package = match.str(1);
+        ret.major = match.str(2);
+        ret.minor = match.str(3);
+        ret.name = match.str(4);
+    } else if (std::regex_match(s, match, kRE2)) {
+        ret.major = match.str(1);
+        ret.minor = match.str(2);
+        ret.name = match.str(3);
+    } else if (std::regex_match(s, match, kRE3)) {
+        ret.package = match.str(1);
+        ret.major = match.str(2);
+        ret.minor = match.str(3);
+    } else if (std::regex_match(s, match, kRE4)) {
+        ret.name = match.str(0);
+    } else if (std::regex_match(s, match, kRE5)) {
+        ret.isIdentifier = true;
+        ret.name = match.str(0);
+    } else if (std::regex_match(s, match, kRE6)) {
+        ret.package = match.str(1);
+        ret.major = match.str(2);
+        ret.minor = match.str(3);
+        ret.name = match.str(4);
+        ret.valueName = match.str(5);
+    } else if (std::regex_match(s, match, kRE7)) {
+        ret.major = match.str(1);
+        ret.minor = match.str(2);
+        ret.name = match.str(3);
+        ret.valueName = match.str(4);
+    } else if (std::regex_match(s, match, kRE8)) {
+        ret.name = match.str(1);
+        ret.valueName = match.str(2);
+    } else {
+        ret.valid = false;
+    }
+
+    return ret;
+}
+
+#undef RE_COMPONENT
+#undef RE_PATH
+#undef RE_MAJOR
+#undef RE_MINOR
+
+// Names in every form the grammar accepts, plus near misses.
+inline std::vector<std::string> fqNameCorpus() {
+    static const std::vector<std::string> kPackages = {
+        "android.hardware.foo", "android.hidl.base", "vendor.awesome.camera.provider", "a", "_x1",
+    };
+    static const std::vector<std::string> kVersions = {"1.0", "2.12", "10.3"};
+    static const std::vector<std::string> kNames = {
+        "IFoo", "types", "IFoo.Bar", "Baz.Inner.Deep", "T", "_9",
+    };
+    static const std::vector<std::string> kValueNames = {"MY_ENUM_VALUE", "v"};
+    static const std::vector<std::string> kInvalid = {
+        "", "@", "@1.0", "@1.0::", "1.0", "a@", "a@1", "a@1.", "a@.1", "a@1.0::", "a@1.0:IFoo",
+        "a@1.0::IFoo:", "a@1.0::IFoo::V", "a.@1.0", ".a@1.0", "a..b", "a.b.", "9a", "a-b", "a::b",
+        "a:b:c", "a@1.0@2.0", "a@1.0::IFoo.", "IFoo:9", " IFoo", "IFoo ", "a@1.0::IFoo:V.W",
+    };
+
+    std::vector<std::string> corpus = kInvalid;
+    for (const auto& name : kNames) {
+        corpus.push_back(name);
+        for (const auto& value : kValueNames) {
+            corpus.push_back(name + ":" + value);
+        }
+    }
+    for (const auto& version : kVersions) {
+        for (const auto& package : kPackages) {
+            corpus.push_back(package + "@" + version);
+        }
+        for (const auto& name : kNames) {
+            for (const auto& package : kPackages) {
+                corpus.push_back(package + "@" + version + "::" + name);
+                corpus.push_back("@" + version + "::" + name);
+                for (const auto& value : kValueNames) {
+                    corpus.push_back(package + "@" + version + "::" + name + ":" + value);
+                    corpus.push_back("@" + version + "::" + name + ":" + value);
+                }
+            }
+        }
+    }
+    return corpus;
+}
+
+#endif  // HIDL_GEN_UTILS_TEST_REGEX_FQNAME_H_
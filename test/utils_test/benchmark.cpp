@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <hidl-util/FQName.h>
+
+#include <string>
+#include <vector>
+
+#include "RegexFQName.h"
+
+using ::android::FQName;
+
+static void BM_FQNameParse(benchmark::State& state) {
+    const std::vector<std::string> corpus = fqNameCorpus();
+    for (auto _ : state) {
+        for (const std::string& s : corpus) {
+            FQName fqName;
+            benchmark::DoNotOptimize(FQName::parse(s, &fqName));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_FQNameParse);
+
+// The std::regex grammar FQName::parse replaced, for comparison.
+static void BM_FQNameParseRegex(benchmark::State& state) {
+    const std::vector<std::string> corpus = fqNameCorpus();
+    for (auto _ : state) {
+        for (const std::string& s : corpus) {
+            benchmark::DoNotOptimize(regexParseFQName(s));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_FQNameParseRegex);
+
+BENCHMARK_MAIN();
@@ -16,13 +16,22 @@
 
 #define LOG_TAG "libhidl-gen-utils"
 
+#include <hidl-util/FQName.h>
 #include <hidl-util/FqInstance.h>
+#include <hidl-util/Formatter.h>
 #include <hidl-util/StringHelper.h>
 
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
 #include <vector>
 
+#include "RegexFQName.h"
+
+using ::android::FQName;
 using ::android::FqInstance;
+using ::android::Formatter;
 using ::android::StringHelper;
 
 class LibHidlGenUtilsTest : public ::testing::Test {};
@@ -190,6 +199,116 @@ TEST_F(LibHidlGenUtilsTest, FqInstanceIdentifier) {
     ASSERT_FALSE(e.hasInstance());
 }
 
+TEST_F(LibHidlGenUtilsTest, FQNameMatchesRegexGrammar) {
+    for (const std::string& s : fqNameCorpus()) {
+        const RegexFQName expected = regexParseFQName(s);
+
+        FQName fqName;
+        ASSERT_EQ(expected.valid, FQName::parse(s, &fqName)) << s;
+        if (!expected.valid) continue;
+
+        EXPECT_EQ(expected.isIdentifier, fqName.isIdentifier()) << s;
+        EXPECT_EQ(expected.package, fqName.package()) << s;
+        EXPECT_EQ(expected.major.empty() ? "" : expected.major + "." + expected.minor,
+                  fqName.version())
+            << s;
+        EXPECT_EQ(expected.name, fqName.name()) << s;
+        EXPECT_EQ(expected.valueName, fqName.valueName()) << s;
+        EXPECT_EQ(s, fqName.string()) << s;
+    }
+}
+
+TEST_F(LibHidlGenUtilsTest, FQNameOrderAndHash) {
+    std::vector<FQName> fqNames;
+    for (const std::string& s : fqNameCorpus()) {
+        FQName fqName;
+        if (FQName::parse(s, &fqName)) fqNames.push_back(fqName);
+    }
+
+    for (const FQName& a : fqNames) {
+        for (const FQName& b : fqNames) {
+            EXPECT_EQ(a.string() < b.string(), a < b) << a.string() << " " << b.string();
+            EXPECT_EQ(a.string() == b.string(), a == b) << a.string() << " " << b.string();
+        }
+        EXPECT_EQ(std::hash<FQName>()(a), std::hash<FQName>()(FQName(a.string())));
+    }
+
+    // android.hardware.foo < android.hardware@1.0, as strings
+    EXPECT_TRUE(FQName("android.hardware.foo@1.0") < FQName("android.hardware@1.0"));
+    EXPECT_TRUE(FQName("a@1.0::IFoo") < FQName("a@1.0::IFoo.Bar"));
+    EXPECT_TRUE(FQName("a@1.0::IFoo") < FQName("a@1.0::IFoo:V"));
+    EXPECT_TRUE(FQName("a@10.0") < FQName("a@2.0"));
+    EXPECT_EQ((std::vector<std::string>{"IFoo", "Bar"}), FQName("a@1.0::IFoo.Bar").names());
+    EXPECT_TRUE(FQName("a@1.0").names().empty());
+
+    // A package without a version prints, and parses, like a name.
+    FQName packageRoot("android.hardware", "", "");
+    EXPECT_EQ(FQName("android.hardware"), packageRoot);
+    EXPECT_EQ(std::hash<FQName>()(FQName("android.hardware")), std::hash<FQName>()(packageRoot));
+    EXPECT_FALSE(FQName("android.hardware@1.0") == packageRoot);
+}
+
+TEST_F(LibHidlGenUtilsTest, FormatterInMemory) {
+    Formatter out = Formatter::inMemory();
+    out << "struct Foo ";
+    out.block([&] {
+        out << "int a;\n\n";
+        out.setLinePrefix("// ");
+        out << "comment\n\n";
+        out.unsetLinePrefix();
+        out << 'b' << 1 << "\n";
+    }).endl();
+
+    EXPECT_EQ("struct Foo {\n"
+              "    int a;\n"
+              "\n"
+              "    // comment\n"
+              "    // \n"
+              "    b1\n"
+              "}\n",
+              out.getOutput());
+}
+
+TEST_F(LibHidlGenUtilsTest, FormatterForFileIfChanged) {
+    char dir[] = "/tmp/hidl-gen-formatter-XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    const std::string path = std::string(dir) + "/out.h";
+
+    auto writeFile = [&](const std::string& content) {
+        Formatter out = Formatter::forFileIfChanged(path);
+        ASSERT_TRUE(out.isValid());
+        out << content;
+        EXPECT_TRUE(out.close());
+    };
+    auto inode = [&] {
+        struct stat st;
+        EXPECT_EQ(0, stat(path.c_str(), &st));
+        return st.st_ino;
+    };
+
+    writeFile("a\n");
+    const ino_t first = inode();
+
+    // same content, untouched
+    writeFile("a\n");
+    EXPECT_EQ(first, inode());
+
+    // replaced by rename
+    writeFile("b\n");
+    EXPECT_NE(first, inode());
+
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ("b\n", content);
+
+    // the temporary file cannot be created
+    EXPECT_FALSE(Formatter::forFileIfChanged(std::string(dir) + "/missing/out.h").isValid());
+
+    // no temporary files are left behind
+    EXPECT_EQ(0, unlink(path.c_str()));
+    EXPECT_EQ(0, rmdir(dir));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
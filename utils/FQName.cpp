@@ -20,26 +20,50 @@
 
 #include <android-base/logging.h>
 #include <android-base/parseint.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
-#include <regex>
-#include <sstream>
-
-#define RE_COMPONENT    "[a-zA-Z_][a-zA-Z_0-9]*"
-#define RE_PATH         RE_COMPONENT "(?:[.]" RE_COMPONENT ")*"
-#define RE_MAJOR        "[0-9]+"
-#define RE_MINOR        "[0-9]+"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace android {
 
+struct FQName::Interned {
+    std::string string;
+    std::vector<std::string> components;  // string split at '.'
+};
+
+const FQName::Interned* FQName::intern(const std::string& s) {
+    static const Interned kEmpty;
+    if (s.empty()) {
+        return &kEmpty;
+    }
+
+    // Leaked, so that global FQNames can be destroyed in any order.
+    static std::mutex* mutex = new std::mutex;
+    static auto* table = new std::unordered_map<std::string, std::unique_ptr<Interned>>;
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    std::unique_ptr<Interned>& interned = (*table)[s];
+    if (interned == nullptr) {
+        interned.reset(new Interned{s, {}});
+        StringHelper::SplitString(s, '.', &interned->components);
+    }
+    return interned.get();
+}
+
 FQName::FQName()
     : mValid(false),
-      mIsIdentifier(false) {
+      mIsIdentifier(false),
+      mPackage(intern("")),
+      mName(intern("")),
+      mValueName(intern("")) {
 }
 
 // TODO(b/73774955): delete
 FQName::FQName(const std::string &s)
-    : mValid(false),
-      mIsIdentifier(false) {
+    : FQName() {
     (void)setTo(s);
 }
 
@@ -54,9 +78,9 @@ FQName::FQName(
         const std::string &valueName)
     : mValid(true),
       mIsIdentifier(false),
-      mPackage(package),
-      mName(name),
-      mValueName(valueName) {
+      mPackage(intern(package)),
+      mName(intern(name)),
+      mValueName(intern(valueName)) {
     CHECK(setVersion(version)) << version;
 
     // Check if this is actually a valid fqName
@@ -84,91 +108,184 @@ bool FQName::isIdentifier() const {
 }
 
 bool FQName::isFullyQualified() const {
-    return !mPackage.empty() && !version().empty() && !mName.empty();
+    return !mPackage->string.empty() && !version().empty() && !mName->string.empty();
 }
 
 bool FQName::isValidValueName() const {
     return mIsIdentifier
-        || (!mName.empty() && !mValueName.empty());
+        || (!mName->string.empty() && !mValueName->string.empty());
 }
 
 bool FQName::isInterfaceName() const {
-    return !mName.empty() && mName[0] == 'I' && mName.find('.') == std::string::npos;
+    return !mName->string.empty() && mName->string[0] == 'I' && mName->string.find('.') == std::string::npos;
+}
+
+// Scanners for the pieces of an FQName. Each one consumes its piece
+// starting at *pos and returns false, leaving *pos unchanged, if there is
+// no such piece there.
+
+static bool isComponentStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool isComponentChar(char c) {
+    return isComponentStart(c) || (c >= '0' && c <= '9');
+}
+
+// [a-zA-Z_][a-zA-Z_0-9]*
+static bool consumeComponent(const std::string& s, size_t* pos) {
+    if (*pos >= s.size() || !isComponentStart(s[*pos])) return false;
+    size_t i = *pos + 1;
+    while (i < s.size() && isComponentChar(s[i])) i++;
+    *pos = i;
+    return true;
+}
+
+// component(.component)*
+static bool consumePath(const std::string& s, size_t* pos, size_t* numComponents) {
+    size_t i = *pos;
+    if (!consumeComponent(s, &i)) return false;
+    *numComponents = 1;
+
+    size_t next = i + 1;
+    while (i < s.size() && s[i] == '.' && consumeComponent(s, &next)) {
+        i = next;
+        next = i + 1;
+        (*numComponents)++;
+    }
+    *pos = i;
+    return true;
+}
+
+// [0-9]+
+static bool consumeNumber(const std::string& s, size_t* pos) {
+    size_t i = *pos;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') i++;
+    if (i == *pos) return false;
+    *pos = i;
+    return true;
+}
+
+// major.minor
+static bool consumeVersion(const std::string& s, size_t* pos, std::string* major,
+                           std::string* minor) {
+    size_t i = *pos;
+    if (!consumeNumber(s, &i)) return false;
+    const size_t dot = i;
+    if (dot >= s.size() || s[dot] != '.') return false;
+    i++;
+    if (!consumeNumber(s, &i)) return false;
+
+    *major = s.substr(*pos, dot - *pos);
+    *minor = s.substr(dot + 1, i - dot - 1);
+    *pos = i;
+    return true;
+}
+
+namespace {
+
+// The pieces of a syntactically valid FQName, as substrings of it.
+struct FQNamePieces {
+    std::string package;
+    bool hasVersion = false;
+    std::string major;
+    std::string minor;
+    std::string name;
+    size_t nameComponents = 0;
+    std::string valueName;
+};
+
+}  // namespace
+
+// :component at the end of s
+static bool scanValueName(const std::string& s, size_t pos, FQNamePieces* pieces) {
+    CHECK(s[pos] == ':');
+    const size_t start = ++pos;
+    if (!consumeComponent(s, &pos) || pos != s.size()) return false;
+    pieces->valueName = s.substr(start);
+    return true;
+}
+
+static bool scanFQName(const std::string& s, FQNamePieces* pieces) {
+    size_t pos = 0;
+
+    if (!s.empty() && s[0] != '@') {
+        size_t numComponents;
+        if (!consumePath(s, &pos, &numComponents)) return false;
+        const std::string path = s.substr(0, pos);
+
+        // IFoo.Type, Type
+        if (pos == s.size()) {
+            pieces->name = path;
+            pieces->nameComponents = numComponents;
+            return true;
+        }
+
+        // IFoo.Type:MY_ENUM_VALUE
+        if (s[pos] == ':') {
+            pieces->name = path;
+            pieces->nameComponents = numComponents;
+            return scanValueName(s, pos, pieces);
+        }
+
+        pieces->package = path;
+    }
+
+    // @1.0
+    if (pos >= s.size() || s[pos] != '@') return false;
+    pos++;
+    if (!consumeVersion(s, &pos, &pieces->major, &pieces->minor)) return false;
+    pieces->hasVersion = true;
+
+    // a version is only allowed on its own after a package
+    if (pos == s.size()) return !pieces->package.empty();
+
+    // ::IFoo.Type
+    if (s.compare(pos, 2, "::") != 0) return false;
+    pos += 2;
+    const size_t nameStart = pos;
+    if (!consumePath(s, &pos, &pieces->nameComponents)) return false;
+    pieces->name = s.substr(nameStart, pos - nameStart);
+    if (pos == s.size()) return true;
+
+    // :MY_ENUM_VALUE
+    if (s[pos] != ':') return false;
+    return scanValueName(s, pos, pieces);
 }
 
 bool FQName::setTo(const std::string &s) {
+    // Accepts exactly one of the following forms:
     // android.hardware.foo@1.0::IFoo.Type
-    static const std::regex kRE1("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
     // @1.0::IFoo.Type
-    static const std::regex kRE2("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
     // android.hardware.foo@1.0 (for package declaration and whole package import)
-    static const std::regex kRE3("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")");
     // IFoo.Type
-    static const std::regex kRE4("(" RE_COMPONENT ")([.]" RE_COMPONENT ")+");
     // Type (a plain identifier)
-    static const std::regex kRE5("(" RE_COMPONENT ")");
-
     // android.hardware.foo@1.0::IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE6("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH
-                                 "):(" RE_COMPONENT ")");
     // @1.0::IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE7("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH "):(" RE_COMPONENT
-                                 ")");
     // IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE8("(" RE_PATH "):(" RE_COMPONENT ")");
 
     bool invalid = false;
     clear();
 
-    std::smatch match;
-    if (std::regex_match(s, match, kRE1)) {
-        CHECK_EQ(match.size(), 5u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-        mName = match.str(4);
-    } else if (std::regex_match(s, match, kRE2)) {
-        CHECK_EQ(match.size(), 4u);
-
-        invalid |= !parseVersion(match.str(1), match.str(2));
-        mName = match.str(3);
-    } else if (std::regex_match(s, match, kRE3)) {
-        CHECK_EQ(match.size(), 4u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-    } else if (std::regex_match(s, match, kRE4)) {
-        mName = match.str(0);
-    } else if (std::regex_match(s, match, kRE5)) {
-        mIsIdentifier = true;
-        mName = match.str(0);
-    } else if (std::regex_match(s, match, kRE6)) {
-        CHECK_EQ(match.size(), 6u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-        mName = match.str(4);
-        mValueName = match.str(5);
-    } else if (std::regex_match(s, match, kRE7)) {
-        CHECK_EQ(match.size(), 5u);
-
-        invalid |= !parseVersion(match.str(1), match.str(2));
-        mName = match.str(3);
-        mValueName = match.str(4);
-    } else if (std::regex_match(s, match, kRE8)) {
-        CHECK_EQ(match.size(), 3u);
-
-        mName = match.str(1);
-        mValueName = match.str(2);
+    FQNamePieces pieces;
+    if (scanFQName(s, &pieces)) {
+        mPackage = intern(pieces.package);
+        if (pieces.hasVersion) {
+            invalid |= !parseVersion(pieces.major, pieces.minor);
+        }
+        mName = intern(pieces.name);
+        mValueName = intern(pieces.valueName);
+        mIsIdentifier = mPackage->string.empty() && !pieces.hasVersion && pieces.nameComponents == 1 &&
+                        mValueName->string.empty();
     } else {
         invalid = true;
     }
 
-    // mValueName must go with mName.
-    CHECK(mValueName.empty() || !mName.empty());
+    // mValueName->string must go with mName->string.
+    CHECK(mValueName->string.empty() || !mName->string.empty());
 
     // package without version is not allowed.
-    CHECK(invalid || mPackage.empty() || !version().empty());
+    CHECK(invalid || mPackage->string.empty() || !version().empty());
 
     // TODO(b/73774955): remove isValid and users
     // of old FQName constructors
@@ -176,7 +293,7 @@ bool FQName::setTo(const std::string &s) {
 }
 
 const std::string& FQName::package() const {
-    return mPackage;
+    return mPackage->string;
 }
 
 std::string FQName::version() const {
@@ -201,27 +318,26 @@ std::string FQName::atVersion() const {
 void FQName::clear() {
     mValid = true;
     mIsIdentifier = false;
-    mPackage.clear();
+    mPackage = intern("");
     clearVersion();
-    mName.clear();
-    mValueName.clear();
+    mName = intern("");
+    mValueName = intern("");
 }
 
 bool FQName::setVersion(const std::string& v) {
-    static const std::regex kREVer("(" RE_MAJOR ")[.](" RE_MINOR ")");
-
     if (v.empty()) {
         clearVersion();
         return true;
     }
 
-    std::smatch match;
-    if (!std::regex_match(v, match, kREVer)) {
+    size_t pos = 0;
+    std::string major;
+    std::string minor;
+    if (!consumeVersion(v, &pos, &major, &minor) || pos != v.size()) {
         return mValid = false;
     }
-    CHECK_EQ(match.size(), 3u);
 
-    return parseVersion(match.str(1), match.str(2));
+    return parseVersion(major, minor);
 }
 
 void FQName::clearVersion() {
@@ -240,25 +356,19 @@ bool FQName::parseVersion(const std::string& majorStr, const std::string& minorS
 }
 
 const std::string& FQName::name() const {
-    return mName;
+    return mName->string;
 }
 
-std::vector<std::string> FQName::names() const {
-    std::vector<std::string> res {};
-    std::istringstream ss(name());
-    std::string s;
-    while (std::getline(ss, s, '.')) {
-        res.push_back(s);
-    }
-    return res;
+const std::vector<std::string>& FQName::names() const {
+    return mName->components;
 }
 
 const std::string& FQName::valueName() const {
-    return mValueName;
+    return mValueName->string;
 }
 
 FQName FQName::typeName() const {
-    return FQName(mPackage, version(), mName);
+    return FQName(mPackage->string, version(), mName->string);
 }
 
 void FQName::applyDefaults(
@@ -266,10 +376,10 @@ void FQName::applyDefaults(
         const std::string &defaultVersion) {
 
     // package without version is not allowed.
-    CHECK(mPackage.empty() || !version().empty());
+    CHECK(mPackage->string.empty() || !version().empty());
 
-    if (mPackage.empty()) {
-        mPackage = defaultPackage;
+    if (mPackage->string.empty()) {
+        mPackage = intern(defaultPackage);
     }
 
     if (version().empty()) {
@@ -278,42 +388,140 @@ void FQName::applyDefaults(
 }
 
 std::string FQName::string() const {
-    CHECK(mValid) << mPackage << atVersion() << mName;
+    CHECK(mValid) << mPackage->string << atVersion() << mName->string;
 
     std::string out;
-    out.append(mPackage);
+    out.append(mPackage->string);
     out.append(atVersion());
-    if (!mName.empty()) {
-        if (!mPackage.empty() || !version().empty()) {
+    if (!mName->string.empty()) {
+        if (!mPackage->string.empty() || !version().empty()) {
             out.append("::");
         }
-        out.append(mName);
+        out.append(mName->string);
 
-        if (!mValueName.empty()) {
+        if (!mValueName->string.empty()) {
             out.append(":");
-            out.append(mValueName);
+            out.append(mValueName->string);
         }
     }
 
     return out;
 }
 
+namespace {
+
+// The pieces which FQName::string() concatenates.
+struct StringPieces {
+    static constexpr size_t kMaxPieces = 6;
+
+    const char* data[kMaxPieces];
+    size_t size[kMaxPieces];
+    size_t count = 0;
+
+    char version[48];  // "@<major>.<minor>"
+
+    void add(const char* d, size_t s) {
+        if (s == 0) return;
+        data[count] = d;
+        size[count] = s;
+        count++;
+    }
+};
+
+}  // namespace
+
+static void getStringPieces(const std::string& package, size_t major, size_t minor,
+                            const std::string& name, const std::string& valueName,
+                            StringPieces* pieces) {
+    pieces->add(package.data(), package.size());
+    if (major > 0) {
+        int size = snprintf(pieces->version, sizeof(pieces->version), "@%zu.%zu", major, minor);
+        pieces->add(pieces->version, size);
+    }
+    if (!name.empty()) {
+        if (!package.empty() || major > 0) {
+            pieces->add("::", 2);
+        }
+        pieces->add(name.data(), name.size());
+
+        if (!valueName.empty()) {
+            pieces->add(":", 1);
+            pieces->add(valueName.data(), valueName.size());
+        }
+    }
+}
+
 bool FQName::operator<(const FQName &other) const {
-    return string() < other.string();
+    if (*this == other) {
+        return false;
+    }
+
+    StringPieces a;
+    StringPieces b;
+    getStringPieces(mPackage->string, mMajor, mMinor, mName->string, mValueName->string, &a);
+    getStringPieces(other.mPackage->string, other.mMajor, other.mMinor, other.mName->string,
+                    other.mValueName->string, &b);
+
+    // Compare the concatenations of the pieces, piece by piece.
+    size_t ai = 0, aOffset = 0;
+    size_t bi = 0, bOffset = 0;
+    while (ai < a.count && bi < b.count) {
+        size_t n = std::min(a.size[ai] - aOffset, b.size[bi] - bOffset);
+        int cmp = memcmp(a.data[ai] + aOffset, b.data[bi] + bOffset, n);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+
+        aOffset += n;
+        bOffset += n;
+        if (aOffset == a.size[ai]) {
+            ai++;
+            aOffset = 0;
+        }
+        if (bOffset == b.size[bi]) {
+            bi++;
+            bOffset = 0;
+        }
+    }
+    return ai == a.count && bi < b.count;
 }
 
 bool FQName::operator==(const FQName &other) const {
-    return string() == other.string();
+    CHECK(mValid && other.mValid);
+
+    if (mPackage == other.mPackage && mMajor == other.mMajor && mMinor == other.mMinor &&
+        mName == other.mName && mValueName == other.mValueName) {
+        return true;
+    }
+
+    // Without a version, a package prints like a name, and FQNames which
+    // print the same are equal, e.g. a package root and what parsing it
+    // gives. With a version, equal strings mean equal components.
+    return !hasVersion() && !other.hasVersion() && string() == other.string();
 }
 
 bool FQName::operator!=(const FQName &other) const {
     return !(*this == other);
 }
 
+size_t FQName::hash() const {
+    if (!hasVersion()) {
+        // Must agree with operator==.
+        return std::hash<std::string>()(string());
+    }
+
+    size_t hash = std::hash<const void*>()(mPackage);
+    for (size_t value : {std::hash<const void*>()(mName), std::hash<const void*>()(mValueName),
+                         mMajor, mMinor}) {
+        hash = hash * 31 + value;
+    }
+    return hash;
+}
+
 const std::string& FQName::getInterfaceName() const {
-    CHECK(isInterfaceName()) << mName;
+    CHECK(isInterfaceName()) << mName->string;
 
-    return mName;
+    return mName->string;
 }
 
 std::string FQName::getInterfaceBaseName() const {
@@ -366,22 +574,22 @@ FQName FQName::getPackageAndVersion() const {
 }
 
 FQName FQName::getTopLevelType() const {
-    auto idx = mName.find('.');
+    auto idx = mName->string.find('.');
 
     if (idx == std::string::npos) {
         return *this;
     }
 
-    return FQName(mPackage, version(), mName.substr(0, idx));
+    return FQName(mPackage->string, version(), mName->string.substr(0, idx));
 }
 
 std::string FQName::tokenName() const {
     std::vector<std::string> components;
     getPackageAndVersionComponents(&components, true /* cpp_compatible */);
 
-    if (!mName.empty()) {
+    if (!mName->string.empty()) {
         std::vector<std::string> nameComponents;
-        StringHelper::SplitString(mName, '.', &nameComponents);
+        StringHelper::SplitString(mName->string, '.', &nameComponents);
 
         components.insert(components.end(), nameComponents.begin(), nameComponents.end());
     }
@@ -401,10 +609,10 @@ std::string FQName::cppNamespace() const {
 
 std::string FQName::cppLocalName() const {
     std::vector<std::string> components;
-    StringHelper::SplitString(mName, '.', &components);
+    StringHelper::SplitString(mName->string, '.', &components);
 
     return StringHelper::JoinStrings(components, "::")
-            + (mValueName.empty() ? "" : ("::" + mValueName));
+            + (mValueName->string.empty() ? "" : ("::" + mValueName->string));
 }
 
 std::string FQName::cppName() const {
@@ -414,8 +622,8 @@ std::string FQName::cppName() const {
     StringHelper::SplitString(name(), '.', &components);
     out += "::";
     out += StringHelper::JoinStrings(components, "::");
-    if (!mValueName.empty()) {
-        out  += "::" + mValueName;
+    if (!mValueName->string.empty()) {
+        out  += "::" + mValueName->string;
     }
 
     return out;
@@ -430,7 +638,7 @@ std::string FQName::javaPackage() const {
 
 std::string FQName::javaName() const {
     return javaPackage() + "." + name()
-            + (mValueName.empty() ? "" : ("." + mValueName));
+            + (mValueName->string.empty() ? "" : ("." + mValueName->string));
 }
 
 void FQName::getPackageComponents(std::vector<std::string> *components) const {
@@ -17,24 +17,130 @@
 #include "Formatter.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
 
 #include <android-base/logging.h>
 
 namespace android {
 
-Formatter::Formatter() : mFile(NULL /* invalid */), mIndentDepth(0), mAtStartOfLine(true) {}
+Formatter::Formatter()
+    : mFile(NULL), mIsValid(false), mIndentDepth(0), mSpacesPerIndent(4), mAtStartOfLine(true) {}
 
 Formatter::Formatter(FILE* file, size_t spacesPerIndent)
     : mFile(file == NULL ? stdout : file),
+      mIsValid(true),
       mIndentDepth(0),
       mSpacesPerIndent(spacesPerIndent),
       mAtStartOfLine(true) {}
 
+Formatter::Formatter(Formatter&& other)
+    : mFile(other.mFile),
+      mIsValid(other.mIsValid),
+      mIndentDepth(other.mIndentDepth),
+      mSpacesPerIndent(other.mSpacesPerIndent),
+      mAtStartOfLine(other.mAtStartOfLine),
+      mSpace(std::move(other.mSpace)),
+      mLinePrefix(std::move(other.mLinePrefix)),
+      mBuffer(std::move(other.mBuffer)),
+      mPath(std::move(other.mPath)),
+      mTmpPath(std::move(other.mTmpPath)) {
+    other.mFile = NULL;
+    other.mIsValid = false;
+    other.mPath.clear();
+    other.mTmpPath.clear();
+}
+
+Formatter Formatter::inMemory(size_t spacesPerIndent) {
+    Formatter formatter;
+    formatter.mIsValid = true;
+    formatter.mSpacesPerIndent = spacesPerIndent;
+    return formatter;
+}
+
+Formatter Formatter::forFileIfChanged(const std::string& path, size_t spacesPerIndent) {
+    const std::string tmpPath = path + ".tmp" + std::to_string(getpid());
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if (file == NULL) {
+        LOG(ERROR) << "Could not open " << tmpPath << ": " << strerror(errno);
+        return invalid();
+    }
+
+    Formatter formatter(file, spacesPerIndent);
+    formatter.mPath = path;
+    formatter.mTmpPath = tmpPath;
+    return formatter;
+}
+
 Formatter::~Formatter() {
+    // Errors are logged, use close() to handle them.
+    close();
+}
+
+bool Formatter::close() {
+    if (mFile == NULL) {
+        return true;
+    }
+
+    if (!mPath.empty()) {
+        return closeIfChanged();
+    }
+
+    bool success = flush();
     if (mFile != stdout) {
-        fclose(mFile);
+        success = (fclose(mFile) == 0) && success;
+    } else {
+        success = (fflush(mFile) == 0) && success;
+    }
+    mFile = NULL;
+
+    if (!success) {
+        LOG(ERROR) << "Could not write generated output: " << strerror(errno);
+    }
+    return success;
+}
+
+bool Formatter::flush() {
+    const bool success =
+        mBuffer.empty() || fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) == mBuffer.size();
+    mBuffer.clear();
+    return success;
+}
+
+bool Formatter::closeIfChanged() {
+    FILE* file = mFile;
+    mFile = NULL;
+
+    struct stat st;
+    if (stat(mPath.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == mBuffer.size()) {
+        std::ifstream existing(mPath, std::ios::binary);
+        std::string content(mBuffer.size(), '\0');
+        if (existing.read(&content[0], content.size()) && content == mBuffer) {
+            fclose(file);
+            unlink(mTmpPath.c_str());
+            mBuffer.clear();
+            return true;
+        }
     }
+
+    mFile = file;
+    bool success = flush();
     mFile = NULL;
+
+    success = (fclose(file) == 0) && success;
+    if (success) {
+        success = (rename(mTmpPath.c_str(), mPath.c_str()) == 0);
+    }
+
+    if (!success) {
+        LOG(ERROR) << "Could not write " << mPath << ": " << strerror(errno);
+        unlink(mTmpPath.c_str());
+    }
+    return success;
 }
 
 void Formatter::indent(size_t level) {
@@ -116,39 +222,47 @@ Formatter& Formatter::sWhile(const std::string& cond, const std::function<void(v
 }
 
 Formatter &Formatter::operator<<(const std::string &out) {
-    const size_t len = out.length();
-    size_t start = 0;
-    while (start < len) {
-        size_t pos = out.find('\n', start);
+    write(out.data(), out.size());
+    return *this;
+}
 
-        if (pos == std::string::npos) {
+Formatter &Formatter::operator<<(const char *out) {
+    write(out, strlen(out));
+    return *this;
+}
+
+void Formatter::writeLineStart() {
+    mBuffer.append(mSpacesPerIndent * mIndentDepth, ' ');
+    mBuffer.append(mLinePrefix);
+}
+
+void Formatter::write(const char* text, size_t length) {
+    CHECK(isValid());
+
+    const char* const end = text + length;
+    while (text < end) {
+        const char* newline = static_cast<const char*>(memchr(text, '\n', end - text));
+
+        if (newline == nullptr) {
             if (mAtStartOfLine) {
-                fprintf(mFile, "%*s", (int)(mSpacesPerIndent * mIndentDepth), "");
-                fprintf(mFile, "%s", mLinePrefix.c_str());
+                writeLineStart();
                 mAtStartOfLine = false;
             }
 
-            output(out.substr(start));
+            mBuffer.append(text, end - text);
             break;
         }
 
-        if (mAtStartOfLine && (pos > start || !mLinePrefix.empty())) {
-            fprintf(mFile, "%*s", (int)(mSpacesPerIndent * mIndentDepth), "");
-            fprintf(mFile, "%s", mLinePrefix.c_str());
+        // Empty lines are not indented, unless there is a line prefix.
+        if (mAtStartOfLine && (newline > text || !mLinePrefix.empty())) {
+            writeLineStart();
         }
 
-        if (pos == start) {
-            fprintf(mFile, "\n");
-            mAtStartOfLine = true;
-        } else if (pos > start) {
-            output(out.substr(start, pos - start + 1));
-            mAtStartOfLine = true;
-        }
+        mBuffer.append(text, newline - text + 1);
+        mAtStartOfLine = true;
 
-        start = pos + 1;
+        text = newline + 1;
     }
-
-    return *this;
 }
 
 // NOLINT to suppress missing parentheses warning about __type__.
@@ -188,13 +302,11 @@ void Formatter::setNamespace(const std::string &space) {
 }
 
 bool Formatter::isValid() const {
-    return mFile != nullptr;
+    return mIsValid;
 }
 
-void Formatter::output(const std::string &text) const {
-    CHECK(isValid());
-
-    fprintf(mFile, "%s", text.c_str());
+const std::string& Formatter::getOutput() const {
+    return mBuffer;
 }
 
 }  // namespace android
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SourceFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+
+std::unique_ptr<SourceFile> SourceFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+
+    const size_t size = st.st_size;
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t mappedSize = (size + kPadding + pageSize - 1) / pageSize * pageSize;
+
+    // Zeroed pages first, then the file over them: the padding reads as NULs
+    // even when it does not fit into the file's last page.
+    void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1 /* fd */, 0 /* offset */);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+    if (size > 0 && mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+                         0 /* offset */) == MAP_FAILED) {
+        munmap(base, mappedSize);
+        close(fd);
+        return nullptr;
+    }
+    close(fd);
+
+    return std::unique_ptr<SourceFile>(
+        new SourceFile(path, static_cast<char*>(base), size, mappedSize));
+}
+
+SourceFile::SourceFile(const std::string& path, char* data, size_t size, size_t mappedSize)
+    : mPath(path), mData(data), mSize(size), mMappedSize(mappedSize) {}
+
+SourceFile::~SourceFile() {
+    munmap(mData, mMappedSize);
+}
+
+}  // namespace android
@@ -18,11 +18,15 @@
 
 #define FQNAME_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
 namespace android {
 
+// The package, name and value name of an FQName are interned: all FQNames
+// share one copy of each distinct string. Copying, comparing for equality
+// and hashing FQNames therefore never touches the characters.
 struct FQName {
     __attribute__((warn_unused_result)) static bool parse(const std::string& s, FQName* into);
 
@@ -83,7 +87,7 @@ struct FQName {
     // std::vector<std::string>{"IFoo","bar","baz"}
 
     const std::string& name() const;
-    std::vector<std::string> names() const;
+    const std::vector<std::string>& names() const;
 
     // The next two methods returns two parts of the FQName, that is,
     // the first part package + version + name, the second part valueName.
@@ -103,10 +107,13 @@ struct FQName {
 
     std::string string() const;
 
+    // Orders like string(), without building the strings.
     bool operator<(const FQName &other) const;
     bool operator==(const FQName &other) const;
     bool operator!=(const FQName &other) const;
 
+    size_t hash() const;
+
     // Must be called on an interface
     // android.hardware.foo@1.0::IBar
     // -> Bar
@@ -228,13 +235,18 @@ struct FQName {
     // TODO(b/73774955): remove
     bool mValid;
 
+    struct Interned;
+
     bool mIsIdentifier;
-    std::string mPackage;
+    const Interned* mPackage;
     // mMajor == 0 means empty.
     size_t mMajor = 0;
     size_t mMinor = 0;
-    std::string mName;
-    std::string mValueName;
+    const Interned* mName;
+    const Interned* mValueName;
+
+    // Returns the single copy of s. Interned strings are never freed.
+    static const Interned* intern(const std::string& s);
 
     void clear();
 
@@ -249,4 +261,13 @@ extern const FQName gIManagerFqName;
 
 }  // namespace android
 
+namespace std {
+
+template <>
+struct hash<android::FQName> {
+    size_t operator()(const android::FQName& fqName) const { return fqName.hash(); }
+};
+
+}  // namespace std
+
 #endif  // FQNAME_H_
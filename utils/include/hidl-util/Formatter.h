@@ -28,14 +28,31 @@ namespace android {
 //     out << "if (good) {\n"; out.indent(); out << "blah\nblah\n"; out.unindent(); out << "}\n";
 // The other is with chain calls and lambda functions
 //     out.sIf("good", [&] { out("blah").endl()("blah").endl(); }).endl();
+//
+// Output is buffered in memory and written to the file in one go by close(),
+// or when the Formatter is destroyed.
 struct Formatter {
     static Formatter invalid() { return Formatter(); }
 
+    // Output is only kept in memory, see getOutput().
+    static Formatter inMemory(size_t spacesPerIndent = 4);
+
+    // Output replaces the file at path, unless the file already has exactly
+    // this content, in which case it is left untouched (keeping its mtime).
+    // The file is replaced atomically by renaming a temporary file over it.
+    // The temporary file is created right away, an invalid Formatter is
+    // returned if that fails.
+    static Formatter forFileIfChanged(const std::string& path, size_t spacesPerIndent = 4);
+
     // Assumes ownership of file. Directed to stdout if file == NULL.
     Formatter(FILE* file, size_t spacesPerIndent = 4);
-    Formatter(Formatter&&) = default;
+    Formatter(Formatter&& other);
     ~Formatter();
 
+    // Writes the buffered output to the file, if any, and closes it. Returns
+    // false if the output could not be written completely.
+    bool close();
+
     void indent(size_t level = 1);
     void unindent(size_t level = 1);
 
@@ -111,6 +128,7 @@ struct Formatter {
         const std::function<void(const typename std::iterator_traits<I>::value_type&)>& func);
 
     Formatter &operator<<(const std::string &out);
+    Formatter &operator<<(const char *out);
 
     Formatter &operator<<(char c);
     Formatter &operator<<(signed char c);
@@ -141,11 +159,15 @@ struct Formatter {
 
     bool isValid() const;
 
+    // Everything formatted so far which has not been written to a file yet.
+    const std::string& getOutput() const;
+
    private:
     // Creates an invalid formatter object.
     Formatter();
 
-    FILE* mFile;  // invalid if nullptr
+    FILE* mFile;  // nullptr if in memory or invalid
+    bool mIsValid;
     size_t mIndentDepth;
     size_t mSpacesPerIndent;
     bool mAtStartOfLine;
@@ -153,7 +175,17 @@ struct Formatter {
     std::string mSpace;
     std::string mLinePrefix;
 
-    void output(const std::string &text) const;
+    std::string mBuffer;
+
+    // file to replace if its content changed, and the temporary file mFile
+    // writes to, see forFileIfChanged
+    std::string mPath;
+    std::string mTmpPath;
+
+    void write(const char* text, size_t length);
+    void writeLineStart();
+    bool flush();
+    bool closeIfChanged();
 
     Formatter(const Formatter&) = delete;
     void operator=(const Formatter&) = delete;
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOURCE_FILE_H_
+
+#define SOURCE_FILE_H_
+
+#include <memory>
+#include <string>
+
+namespace android {
+
+// The contents of a file, memory-mapped instead of read. A parse maps its
+// .hal file once, hashes the mapping and then lexes it, see
+// Hash::getHash(const SourceFile&).
+struct SourceFile {
+    // Maps the current contents of the file at path. nullptr if it cannot be
+    // opened.
+    static std::unique_ptr<SourceFile> open(const std::string& path);
+
+    ~SourceFile();
+
+    const std::string& path() const { return mPath; }
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    // The contents followed by kPadding NULs, for flex' yy_scan_buffer,
+    // which scans in place. Its pages are private: flex writes NULs into
+    // them, which copies each page it writes to and is never seen by the
+    // file. data() is therefore only the file's contents until scanned.
+    static constexpr size_t kPadding = 2;
+    char* scanBuffer() { return mData; }
+    size_t scanBufferSize() const { return mSize + kPadding; }
+
+   private:
+    SourceFile(const std::string& path, char* data, size_t size, size_t mappedSize);
+
+    const std::string mPath;
+    char* const mData;
+    const size_t mSize;
+    const size_t mMappedSize;
+
+    SourceFile(const SourceFile&) = delete;
+    void operator=(const SourceFile&) = delete;
+};
+
+}  // namespace android
+
+#endif  // SOURCE_FILE_H_